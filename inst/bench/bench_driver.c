@@ -0,0 +1,378 @@
+/*-----------------------------------------------------------------------------
+ * Native benchmark driver for the udunits package's compiled routines:
+ * calendar decoding and encoding on each calendar, units string scanning,
+ * and unit conversion, for vector sizes from 1 up to a given maximum.
+ * Results are written as CSV, with the same columns as udunits_bench.R
+ * writes, so that runs can be compared between releases.
+ *
+ * This times the C routines directly, without R.  It must be built from a
+ * source copy of the package, e.g. from this directory:
+ *
+ *	cc -O2 -fopenmp -I/path/to/udunits/include -I../../src -o bench_driver \
+ *		bench_driver.c ../../src/utCalendar_cal.c ../../src/utScan_cache.c \
+ *		../../src/utConvert_values.c ../../src/utStats.c -L/path/to/udunits/lib -ludunits -lm
+ *
+ * Usage: bench_driver [-max N] [-reps R] [-threads T] [-out file.csv]
+ *        bench_driver -verify N
+ * UDUNITS_PATH must point to the units file, as for the R package.
+ *
+ * With -verify, nothing is timed; instead N values in each of a set of time
+ * units are decoded on the standard calendar both by the package's own kernel
+ * (utCalendar_standard_batch, which the package only uses when built with
+ * -DUDU_STD_NATIVE) and by the udunits library's utCalendar, and any
+ * differences are listed.
+ * The exit status is 1 if there are any.
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "udunits.h"
+#include "utCalendar_cal.h"
+#include "utScan_cache.h"
+#include "utConvert_values.h"
+
+#define BENCH_VERSION	"1.3.1"
+
+static FILE		*out;
+static int		reps = 3;
+static size_t		bytes_allocated;	/* by the driver, for the current case */
+static udu_cal_context	ctx;
+
+/******************************************************************************/
+static double now( void )
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec	ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return( ts.tv_sec + 1e-9*ts.tv_nsec );
+#else
+	struct timeval	tv;
+
+	gettimeofday( &tv, NULL );
+	return( tv.tv_sec + 1e-6*tv.tv_usec );
+#endif
+}
+
+/******************************************************************************/
+/* Peak resident set size of this process, in kilobytes */
+static long peak_rss_kb( void )
+{
+	struct rusage	ru;
+
+	getrusage( RUSAGE_SELF, &ru );
+#ifdef __APPLE__
+	return( ru.ru_maxrss / 1024 );	/* bytes on macOS */
+#else
+	return( ru.ru_maxrss );
+#endif
+}
+
+/******************************************************************************/
+static void *bench_alloc( size_t n )
+{
+	void	*p;
+
+	if( (p = malloc( n )) == NULL ) {
+		fprintf( stderr, "bench_driver: out of memory allocating %lu bytes\n", (unsigned long)n );
+		exit(1);
+		}
+	bytes_allocated += n;
+	return( p );
+}
+
+/******************************************************************************/
+static int cmp_double( const void *a, const void *b )
+{
+	double	x = *(const double *)a, y = *(const double *)b;
+
+	return( (x < y) ? -1 : (x > y) );
+}
+
+/******************************************************************************/
+/* Writes one result line; 'times' holds the time of each repetition */
+static void report( const char *bench_case, const char *calendar, const char *style, size_t n, double *times )
+{
+	double	med;
+
+	qsort( times, reps, sizeof(double), cmp_double );
+	med = times[reps/2];
+
+	fprintf( out, "native,%s,%s,%s,%s,%lu,%d,%d,%.6g,%.3f,%.0f,%ld\n", BENCH_VERSION, bench_case, calendar,
+		style, (unsigned long)n, reps, ctx.nthreads, med, 1e9*med/(double)n, (double)bytes_allocated,
+		peak_rss_kb() );
+	fflush( out );
+}
+
+/******************************************************************************/
+/* Values spread over a few centuries, the same every run */
+static void fill_values( double *vals, size_t n )
+{
+	size_t	i;
+
+	srand( 20010101 );
+	for( i=0; i<n; i++ )
+		vals[i] = (double)(rand() % 100000) + 0.25*(rand() % 4);
+}
+
+/******************************************************************************/
+static void bench_calendar( size_t n, const char *calname )
+{
+	utUnit		u;
+	udu_calendar_id	cal_id;
+	double		*vals, *second, *back, times[64], t0;
+	int		*year, *month, *day, *hour, *minute, r, k;
+	size_t		i;
+	float		fsec;
+
+	utScan( "days since 1850-01-01", &u );
+	cal_id = utCalendar_cal_id( calname );
+
+	bytes_allocated = 0;
+	vals   = (double *)bench_alloc( n*sizeof(double) );
+	second = (double *)bench_alloc( n*sizeof(double) );
+	back   = (double *)bench_alloc( n*sizeof(double) );
+	year   = (int *)bench_alloc( n*sizeof(int) );
+	month  = (int *)bench_alloc( n*sizeof(int) );
+	day    = (int *)bench_alloc( n*sizeof(int) );
+	hour   = (int *)bench_alloc( n*sizeof(int) );
+	minute = (int *)bench_alloc( n*sizeof(int) );
+	fill_values( vals, n );
+
+	/* One value per call, through the original interface; capped, since it is slow */
+	if( n <= 100000 ) {
+		for( r=0; r<reps; r++ ) {
+			t0 = now();
+			for( i=0; i<n; i++ )
+				utCalendar_cal( vals[i], &u, year+i, month+i, day+i, hour+i, minute+i, &fsec, (char *)calname );
+			times[r] = now() - t0;
+			}
+		report( "utCalendar_cal", calname, "scalar", n, times );
+		}
+
+	for( r=0; r<reps; r++ ) {
+		t0 = now();
+		if( (k = utCalendar_cal_batch( &ctx, vals, n, &u, cal_id, year, month, day, hour, minute, second )) != 0 ) {
+			fprintf( stderr, "bench_driver: utCalendar_cal_batch returned %d\n", k );
+			exit(1);
+			}
+		times[r] = now() - t0;
+		}
+	report( "utCalendar_cal_batch", calname, "array", n, times );
+
+	for( r=0; r<reps; r++ ) {
+		t0 = now();
+		utInvCalendar_cal_batch( &ctx, year, month, day, hour, minute, second, n, &u, cal_id, back );
+		times[r] = now() - t0;
+		}
+	report( "utInvCalendar_cal_batch", calname, "array", n, times );
+
+	free( vals ); free( second ); free( back );
+	free( year ); free( month ); free( day ); free( hour ); free( minute );
+}
+
+/******************************************************************************/
+static void bench_scan( size_t n )
+{
+	static const char *specs[] = { "days since 1850-01-01", "K", "degC", "m/s", "kg m-2 s-1", "hPa",
+		"hours since 1979-01-01 00:00:00", "mm/day" };
+	utUnit	u;
+	double	times[64], t0;
+	size_t	i;
+	int	r, nspecs = sizeof(specs)/sizeof(specs[0]);
+
+	bytes_allocated = 0;
+
+	for( r=0; r<reps; r++ ) {
+		t0 = now();
+		for( i=0; i<n; i++ )
+			utScan( (char *)specs[i % nspecs], &u );
+		times[r] = now() - t0;
+		}
+	report( "utScan", "", "uncached", n, times );
+
+	for( r=0; r<reps; r++ ) {
+		utScan_cache_clear();
+		t0 = now();
+		for( i=0; i<n; i++ )
+			utScan_cached( specs[i % nspecs], &u );
+		times[r] = now() - t0;
+		}
+	report( "utScan", "", "cached", n, times );
+}
+
+/******************************************************************************/
+static void bench_convert( size_t n )
+{
+	utUnit	from, to;
+	double	*vals, *res, slope, intercept, times[64], t0;
+	int	r;
+
+	utScan( "K", &from );
+	utScan( "degC", &to );
+
+	bytes_allocated = 0;
+	vals = (double *)bench_alloc( n*sizeof(double) );
+	res  = (double *)bench_alloc( n*sizeof(double) );
+	fill_values( vals, n );
+
+	for( r=0; r<reps; r++ ) {
+		t0 = now();
+		utConvert( &from, &to, &slope, &intercept );
+		utConvert_values_double( vals, res, n, slope, intercept, NULL, 0 );
+		times[r] = now() - t0;
+		}
+	report( "utConvert", "", "values", n, times );
+
+	free( vals ); free( res );
+}
+
+/******************************************************************************/
+/* Seconds between two dates on the standard calendar */
+static double std_diff( int y1, int mo1, int d1, int h1, int mi1, double s1, 
+			int y2, int mo2, int d2, int h2, int mi2, double s2 )
+{
+	return( (double)(udu_jdn_from_standard( y1, mo1, d1 ) - udu_jdn_from_standard( y2, mo2, d2 ))*86400. +
+		(double)((h1-h2)*3600L + (mi1-mi2)*60L) + (s1 - s2) );
+}
+
+/******************************************************************************/
+/* Differential test of the standard calendar kernel against the library.
+ * The library gives seconds as a float, so they are compared to float 
+ * precision; a value where the two land either side of a minute (or day)
+ * boundary by less than that counts as a rounding difference, not a mismatch.
+ */
+static int verify_standard( size_t n )
+{
+	static const char *units[] = { "days since 1850-01-01", "hours since 1900-01-01 00:00:00", 
+		"seconds since 1970-01-01", "minutes since 2001-01-01 06:30", "days since 0001-01-01",
+		"days since 1582-10-15", "hours since 1582-10-04 12:00", "days since -0100-03-01",
+		"days since 1601-01-01", "hours since 1000-07-15 03:00" };
+	static const double spread[] = { 1e5, 1e6, 1e10, 1e7, 1e6, 1e4, 1e5, 1e5, 2e5, 1e7 };
+	utUnit	u;
+	double	*vals, *second, d, maxd;
+	int	*year, *month, *day, *hour, *minute, y, mo, dy, h, mi, nu, k, err;
+	long	nexact, nround, nbad;
+	float	fsec;
+	size_t	i;
+
+	vals   = (double *)bench_alloc( n*sizeof(double) );
+	second = (double *)bench_alloc( n*sizeof(double) );
+	year   = (int *)bench_alloc( n*sizeof(int) );
+	month  = (int *)bench_alloc( n*sizeof(int) );
+	day    = (int *)bench_alloc( n*sizeof(int) );
+	hour   = (int *)bench_alloc( n*sizeof(int) );
+	minute = (int *)bench_alloc( n*sizeof(int) );
+
+	nbad = 0;
+	nu   = (int)(sizeof(units)/sizeof(units[0]));
+	srand( 15821015 );
+	for( k=0; k<nu; k++ ) {
+		if( (err = utScan( (char *)units[k], &u )) != 0 ) {
+			fprintf( stderr, "bench_driver: can't scan \"%s\": %d\n", units[k], err );
+			exit(1);
+			}
+
+		/* Whole, half, and arbitrary values, either side of the reference date */
+		for( i=0; i<n; i++ ) {
+			vals[i] = spread[k] * (2.*rand()/(double)RAND_MAX - 1.);
+			if( i % 3 == 0 )
+				vals[i] = floor( vals[i] );
+			else if( i % 3 == 1 )
+				vals[i] = 0.5*floor( 2.*vals[i] );
+			}
+
+		if( (err = utCalendar_standard_batch( &ctx, vals, n, &u, year, month, day, 
+				hour, minute, second )) != 0 ) {
+			fprintf( stderr, "bench_driver: utCalendar_standard_batch returned %d\n", err );
+			exit(1);
+			}
+
+		nexact = nround = 0;
+		maxd   = 0.;
+		for( i=0; i<n; i++ ) {
+			utCalendar( vals[i], &u, &y, &mo, &dy, &h, &mi, &fsec );
+			d = fabs( std_diff( year[i], month[i], day[i], hour[i], minute[i], second[i], y, mo, dy, h, mi, fsec ));
+			if( (year[i] == y) && (month[i] == mo) && (day[i] == dy) && (hour[i] == h) && (minute[i] == mi) &&
+			    (d <= 1e-5*(1. + fabs(fsec))) )
+				nexact++;
+			else if( d <= 1e-3 )
+				nround++;
+			else
+				{
+				if( nbad++ < 20 )
+					fprintf( out, "MISMATCH %s %.17g: kernel %d-%02d-%02d %02d:%02d:%09.6f, library %d-%02d-%02d %02d:%02d:%09.6f\n",
+						units[k], vals[i], year[i], month[i], day[i], hour[i], minute[i], second[i],
+						y, mo, dy, h, mi, (double)fsec );
+				}
+			if( d > maxd )
+				maxd = d;
+			}
+		fprintf( out, "%-36s %lu values: %ld exact, %ld rounding, %ld mismatched; largest difference %.3g s\n",
+			units[k], (unsigned long)n, nexact, nround, (long)(n - nexact - nround), maxd );
+		}
+
+	free( vals ); free( second );
+	free( year ); free( month ); free( day ); free( hour ); free( minute );
+	return( nbad == 0 ? 0 : 1 );
+}
+
+/******************************************************************************/
+int main( int argc, char *argv[] )
+{
+	static const char *calendars[] = { "standard", "noleap", "360_day", "proleptic_gregorian", "julian" };
+	double	maxn = 1e7;
+	size_t	n, nverify = 0;
+	int	i, nthreads = 0;
+
+	out = stdout;
+	for( i=1; i<argc; i++ ) {
+		if( (strcmp( argv[i], "-max" ) == 0) && (i+1 < argc) )
+			maxn = atof( argv[++i] );
+		else if( (strcmp( argv[i], "-reps" ) == 0) && (i+1 < argc) )
+			reps = atoi( argv[++i] );
+		else if( (strcmp( argv[i], "-threads" ) == 0) && (i+1 < argc) )
+			nthreads = atoi( argv[++i] );
+		else if( (strcmp( argv[i], "-verify" ) == 0) && (i+1 < argc) )
+			nverify = (size_t)atof( argv[++i] );
+		else if( (strcmp( argv[i], "-out" ) == 0) && (i+1 < argc) ) {
+			if( (out = fopen( argv[++i], "w" )) == NULL ) {
+				fprintf( stderr, "bench_driver: can't write %s\n", argv[i] );
+				return(1);
+				}
+			}
+		else
+			{
+			fprintf( stderr, "Usage: %s [-max N] [-reps R] [-threads T] [-out file.csv] | -verify N\n", argv[0] );
+			return(1);
+			}
+		}
+	if( (reps < 1) || (reps > 64) )
+		reps = 3;
+
+	if( utInit( NULL ) != 0 ) {
+		fprintf( stderr, "bench_driver: utInit failed; is UDUNITS_PATH set?\n" );
+		return(1);
+		}
+	udu_cal_context_init( &ctx, nthreads );
+
+	if( nverify > 0 )
+		return( verify_standard( nverify ));
+
+	fprintf( out, "driver,version,case,calendar,style,n,reps,threads,sec,ns_per_value,alloc_bytes,peak_rss_kb\n" );
+	for( n=1; (double)n <= maxn; n *= 10 ) {
+		for( i=0; i<(int)(sizeof(calendars)/sizeof(calendars[0])); i++ )
+			bench_calendar( n, calendars[i] );
+		bench_scan( n );
+		bench_convert( n );
+		}
+
+	if( out != stdout )
+		fclose( out );
+	return(0);
+}
@@ -1,57 +1,209 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <udunits.h>
 #include <string.h>
 
 #include <R.h> 
 #include <Rinternals.h>
+#include <R_ext/Rdynload.h>
 
 #include "utCalendar_cal.h"
+#include "utDateList.h"
+#include "utScan_cache.h"
+#include "utConvert_values.h"
+#include "utSnapshot.h"
+#include "utStats.h"
+#include "utDateFormat.h"
+#include "utDateParse.h"
+#include "utCalendarBins.h"
+#include "utCalendarRemap.h"
+#include "utCalendarStream.h"
+#include "utTimeIndex.h"
+#include "utQuantity.h"
+
+/* Set up by R_utInit; the calendar routines only read it */
+static udu_cal_context R_udu_cal_ctx;
+
+/* The units database snapshot, if utInit was given a good one */
+static udu_snapshot R_udu_snap;
+
+/* Whether the udunits library has loaded its units file.  With a 
+ * snapshot, that is put off until something needs the library.
+ */
+#define R_UDU_LIB_NONE		0	/* utInit has not been called */
+#define R_UDU_LIB_LOADED	1
+#define R_UDU_LIB_DEFERRED	2
+static int R_udu_lib_state = R_UDU_LIB_NONE;
+
+/* The units file the library loaded, or "" if that can't be told */
+static char R_udu_lib_path[1024];
 
 /******************************************************************/
-/* Initializes the udunits package.
- * Does NOT support the 'path' argument -- set it using UDUNITS_PATH
- * environmental variable instead!
- * Return value is 0 on success, not zero otherwise.
+/* Called by R when the package's shared library is loaded
  */
-void R_utInit( int *retval )
+void R_init_udunits( DllInfo *dll )
 {
-	*retval = utInit(NULL);
-	if( *retval == 0 )
-		return;
+	R_utDateList_init( dll );
+	R_utQuantity_init( dll );
+}
 
-	if( *retval == UT_ENOFILE ) {
-		fprintf( stderr, "utInit (R version): error: units file not found!\n");
-		fprintf( stderr, "Set environmental variable UDUNITS_PATH to the fully\n");
-		fprintf( stderr, "qualified filename of the udunits units file\n");
-		fprintf( stderr, "(usually named udunits.dat, often found in /usr/local/lib)\n");
-		return;
-		}
+/******************************************************************/
+/* Has the udunits library load its units file, and sets up the
+ * calendar routines.  Raises an R error if the units file can't be 
+ * read.
+ */
+static void R_ututil_load_lib( void )
+{
+	int	retval;
 
-	if( *retval == UT_EALLOC ) {
-		fprintf( stderr, "utInit (R version): memory allocation error!!\n");
+	if( udu_snapshot_lib_path( R_udu_lib_path, sizeof(R_udu_lib_path) ) != 0 )
+		R_udu_lib_path[0] = '\0';
+
+	if( (retval = utInit(NULL)) == 0 ) {
+		if( udu_cal_context_init( &R_udu_cal_ctx, R_udu_cal_ctx.nthreads ) != 0 )
+			error( "utInit (R version): error: could not set up the calendar routines!" );
+		R_udu_lib_state = R_UDU_LIB_LOADED;
 		return;
 		}
 
-	if( *retval == UT_EIO ) {
-		fprintf( stderr, "utInit (R version): I/O error occurred while processing\n");
-		fprintf( stderr, "the udunits file!\n" );
-		return;
+	R_udu_lib_state = R_UDU_LIB_NONE;
+
+	if( retval == UT_ENOFILE ) 
+		error( "utInit (R version): error: units file not found!\n"
+			"Set environmental variable UDUNITS_PATH to the fully\n"
+			"qualified filename of the udunits units file\n"
+			"(usually named udunits.dat, often found in /usr/local/lib)" );
+
+	else if( retval == UT_EALLOC ) 
+		error( "utInit (R version): memory allocation error!!" );
+
+	else if( retval == UT_EIO ) 
+		error( "utInit (R version): I/O error occurred while processing the udunits file!" );
+
+	else if( retval == UT_EUNKNOWN ) 
+		error( "utInit (R version): error: udunits file contains an unknown specification!" );
+
+	else if( retval == UT_ESYNTAX ) 
+		error( "utInit (R version): error: I found a syntax error in the udunits file!" );
+
+	else
+		error( "utInit (R version): error with unknown code: %d!", retval );
+}
+
+/******************************************************************/
+/* Called before anything that uses the udunits library (other than
+ * looking up a name in the snapshot), to load the units file if that 
+ * was put off.
+ */
+static void R_ututil_need_lib( void )
+{
+	if( R_udu_lib_state == R_UDU_LIB_DEFERRED ) {
+		UDU_STAT_EVENT( UDU_STAT_EV_LIB_LOAD );
+		R_ututil_load_lib();
 		}
+}
 
-	if( *retval == UT_EUNKNOWN ) {
-		fprintf( stderr, "utInit (R version): error: udunits file contains an\n");
-		fprintf( stderr, "unknown specification!\n" );
-		return;
+/******************************************************************/
+/* utIsTime, except that if the udunits library hasn't loaded its
+ * units file yet (because a snapshot is being used), the unit's 
+ * powers are compared with those of "second" from the snapshot, 
+ * which is all utIsTime does, without loading it.
+ */
+static int R_ututil_utIsTime( utUnit *u )
+{
+	utUnit	second;
+	int	i;
+
+	if( (R_udu_lib_state == R_UDU_LIB_DEFERRED) && 
+	    (udu_snapshot_lookup( &R_udu_snap, "second", &second ) == 0) ) {
+		for( i=0; i<UT_MAXNUM_BASE_QUANTITIES; i++ )
+			if( u->power[i] != second.power[i] )
+				return(0);
+		return(1);
 		}
 
-	if( *retval == UT_ESYNTAX ) {
-		fprintf( stderr, "utInit (R version): error: I found a syntax error\n");
-		fprintf( stderr, "in the udunits file!\n" );
-		return;
+	R_ututil_need_lib();
+	return( utIsTime( u ));
+}
+
+/******************************************************************/
+/* Initializes the udunits package.
+ * Does NOT support the 'path' argument -- set it using UDUNITS_PATH
+ * environmental variable instead!
+ * If sx_snapshot names a snapshot of the units database (see 
+ * R_utSnapshot_compile) that is intact, up to date, and made from the
+ * units file the library would load, it is used, and the library 
+ * does not read the units file until it is needed.
+ * Otherwise the units file is read now, as usual.
+ * Returns TRUE if the snapshot was used; if not, attribute 'reason'
+ * says why.  Raises an R error if the units file can't be read.
+ */
+SEXP R_utInit( SEXP sx_snapshot )
+{
+	char	errmsg[3200], libpath[1024];
+	SEXP	sx_retval;
+
+	/* Units parsed with the old database might not be valid with the new one */
+	utScan_cache_clear();
+	udu_snapshot_close( &R_udu_snap );
+
+	if( (! isString( sx_snapshot )) || (length( sx_snapshot ) < 1) || 
+	    (STRING_ELT( sx_snapshot, 0 ) == NA_STRING) || (CHAR(STRING_ELT( sx_snapshot, 0 ))[0] == '\0') )
+		strcpy( errmsg, "no snapshot given" );
+
+	else if( udu_snapshot_open( CHAR(STRING_ELT( sx_snapshot, 0 )), &R_udu_snap, errmsg, sizeof(errmsg) ) == 0 ) {
+		/* Names found in the snapshot have to mean what they would in the units file
+		 * the library will load, so it must have been made from that file
+		 */
+		if( udu_snapshot_lib_path( libpath, sizeof(libpath) ) != 0 )
+			snprintf( errmsg, sizeof(errmsg), "can't tell which units file the library would load; "
+				"set environment variable UDUNITS_PATH" );
+		else if( strcmp( libpath, udu_snapshot_source( &R_udu_snap )) != 0 )
+			snprintf( errmsg, sizeof(errmsg), "snapshot %s was made from units file %s, but the library would load %s",
+				CHAR(STRING_ELT( sx_snapshot, 0 )), udu_snapshot_source( &R_udu_snap ), libpath );
+		else
+			{
+			R_udu_lib_state = R_UDU_LIB_DEFERRED;
+			return( ScalarLogical( TRUE ));
+			}
+		udu_snapshot_close( &R_udu_snap );
 		}
 
-	fprintf( stderr, "utInit (R version): error with unknown code: %d!\n",
-		*retval );
+	R_ututil_load_lib();
+
+	PROTECT( sx_retval = ScalarLogical( FALSE ));
+	setAttrib( sx_retval, install("reason"), mkString( errmsg ));
+	UNPROTECT(1);
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Writes a snapshot of units file sx_units_file to file sx_snapshot.
+ * The names come from sx_units_file, but what they mean comes from the
+ * library, so that must be the file the library loaded; that is checked.
+ * Returns the number of unit names in the snapshot.
+ */
+SEXP R_utSnapshot_compile( SEXP sx_units_file, SEXP sx_snapshot )
+{
+	char	errmsg[1200];
+	long	nentries;
+
+	if( R_udu_lib_state == R_UDU_LIB_NONE )
+		error( "utCompileSnapshot (R version): error: udunits package not initialized yet!  You must call utInit() first." );
+	R_ututil_need_lib();
+
+	if( R_udu_lib_path[0] == '\0' )
+		error( "utCompileSnapshot (R version): error: can't tell which units file the library loaded; "
+			"set environment variable UDUNITS_PATH and call utInit() again" );
+	if( strcmp( CHAR(STRING_ELT( sx_units_file, 0 )), R_udu_lib_path ) != 0 )
+		error( "utCompileSnapshot (R version): error: units file %s is not the one the library loaded (%s)",
+			CHAR(STRING_ELT( sx_units_file, 0 )), R_udu_lib_path );
+
+	if( udu_snapshot_compile( CHAR(STRING_ELT( sx_units_file, 0 )), CHAR(STRING_ELT( sx_snapshot, 0 )),
+			&nentries, errmsg, sizeof(errmsg) ) != 0 )
+		error( "utCompileSnapshot (R version): error: %s", errmsg );
+
+	return( ScalarInteger( (int)nentries ));
 }
 
 /******************************************************************
@@ -100,54 +252,477 @@ void R_ututil_Rstyle_to_utUnit( double *origin_factor, int *hasorigin_powers,
 		unit_out->power[i] = (short)hasorigin_powers[i+1];
 }
 
+/******************************************************************
+ * Raises an R error for a nonzero return code from the calendar
+ * routines; does nothing if retval is 0.
+ */
+void R_ututil_calendar_error( int retval )
+{
+	if( retval == 0 )
+		return;
+
+	if( retval == UT_ENOINIT ) 
+		error( "utCalendar (R version): error: udunits package not initialized yet!  You must call utInit() first." );
+
+	else if( retval == UT_EINVALID )
+		error( "utCalendar (R version): error: units are not time-like!" );
+
+	else
+		error( "utCalendar (R version): unknown error %d!\n", retval );
+}
+
+/******************************************************************/
+/* Returns the id of the calendar named in sx_calendar, with a 
+ * warning if it is not one we know.
+ */
+static udu_calendar_id R_ututil_calendar_id( SEXP sx_calendar )
+{
+	udu_calendar_id	cal_id;
+	const char	*calendar;
+
+	calendar = CHAR(STRING_ELT(sx_calendar,0));
+	if( (cal_id = utCalendar_cal_id( calendar )) == UDU_CAL_UNKNOWN ) {
+		UDU_STAT_EVENT( UDU_STAT_EV_UNKNOWN_CALENDAR );
+		warning( "unknown calendar: \"%s\". Using standard calendar instead!", calendar );
+		}
+
+	return( cal_id );
+}
+
+/******************************************************************/
+/* Sets the number of threads the calendar routines split long
+ * vectors across, if sx_nthreads is not NULL; 0 means the OpenMP
+ * default.  Returns the previous setting, or NA if the package was
+ * built without OpenMP (in which case everything runs on one thread).
+ */
+SEXP R_utSetThreads( SEXP sx_nthreads )
+{
+	int	old;
+
+	old = R_udu_cal_ctx.nthreads;
+	if( ! isNull( sx_nthreads )) {
+		if( (asInteger( sx_nthreads ) == NA_INTEGER) || (asInteger( sx_nthreads ) < 0) )
+			error( "utSetThreads (R version): error: number of threads must be 0 or more!" );
+		R_udu_cal_ctx.nthreads = asInteger( sx_nthreads );
+		}
+
+#ifndef _OPENMP
+	old = NA_INTEGER;
+#endif
+	return( ScalarInteger( old ));
+}
+
+/******************************************************************/
+/* Returns the element of list sx_list with name 'name', or R_NilValue
+ */
+static SEXP R_ututil_list_elt( SEXP sx_list, const char *name )
+{
+	SEXP	sx_names;
+	int	i;
+
+	sx_names = getAttrib( sx_list, R_NamesSymbol );
+	if( sx_names == R_NilValue )
+		return( R_NilValue );
+
+	for( i=0; i<length(sx_list); i++ )
+		if( strcmp( CHAR(STRING_ELT(sx_names,i)), name ) == 0 )
+			return( VECTOR_ELT( sx_list, i ));
+
+	return( R_NilValue );
+}
+
+/******************************************************************/
+/* Named integer and double elements of a list, or 0 if missing
+ */
+static int R_ututil_list_int( SEXP sx_list, const char *name )
+{
+	SEXP sx_elt = R_ututil_list_elt( sx_list, name );
+	return( (sx_elt == R_NilValue) ? 0 : asInteger( sx_elt ));
+}
+
+static double R_ututil_list_real( SEXP sx_list, const char *name )
+{
+	SEXP sx_elt = R_ututil_list_elt( sx_list, name );
+	return( (sx_elt == R_NilValue) ? 0. : asReal( sx_elt ));
+}
+
+/******************************************************************/
+/* Makes an external pointer to 'size' bytes of memory.  The memory is
+ * a raw vector kept alive as the 'protected' part of the pointer, so
+ * R's garbage collector frees it along with the pointer and no 
+ * finalizer is needed.  Sets *addr to the memory.  Pointers that have
+ * been saved and loaded into a new R session come back as NULL.
+ */
+static SEXP R_ututil_extptr_new( size_t size, const char *tag, void **addr )
+{
+	SEXP	sx_raw, sx_ptr;
+
+	PROTECT( sx_raw = allocVector( RAWSXP, size ));
+	memset( RAW(sx_raw), 0, size );
+	*addr  = (void *)RAW( sx_raw );
+	sx_ptr = R_MakeExternalPtr( *addr, install(tag), sx_raw );
+	UNPROTECT(1);
+
+	return( sx_ptr );
+}
+
+/******************************************************************/
+/* Returns the address of the external pointer in element 'ptr' of
+ * list sx_list, or NULL if there isn't a valid one with the given tag.
+ */
+static void *R_ututil_extptr_addr( SEXP sx_list, const char *tag )
+{
+	SEXP	sx_ptr;
+
+	sx_ptr = R_ututil_list_elt( sx_list, "ptr" );
+	if( (TYPEOF(sx_ptr) != EXTPTRSXP) || (R_ExternalPtrTag(sx_ptr) != install(tag)) )
+		return( NULL );
+
+	return( R_ExternalPtrAddr( sx_ptr ));
+}
+
+/******************************************************************/
+/* Returns the native unit for a 'udUnits' object, as returned by 
+ * utScan.  This is normally the utUnit that the object's 'ptr' element
+ * points to.  For objects without a valid pointer (saved in an earlier
+ * R session, or made by an older version of this package) the unit is 
+ * rebuilt from the 'originfactor' and 'hasoriginpowers' elements into
+ * *tmp.
+ */
+static utUnit *R_ututil_unit( SEXP sx_unit, utUnit *tmp, const char *caller )
+{
+	utUnit	*u;
+	SEXP	sx_origin_factor, sx_hasorigin_powers;
+
+	if( ! isNewList( sx_unit ))
+		error( "%s (R version): error: I was passed a unit that is NOT of class 'udUnits'!", caller );
+
+	if( (u = (utUnit *)R_ututil_extptr_addr( sx_unit, "utUnit" )) != NULL )
+		return( u );
+
+	sx_origin_factor    = R_ututil_list_elt( sx_unit, "originfactor"    );
+	sx_hasorigin_powers = R_ututil_list_elt( sx_unit, "hasoriginpowers" );
+	if( (TYPEOF(sx_origin_factor) != REALSXP) || (length(sx_origin_factor) < 2) ||
+	    (TYPEOF(sx_hasorigin_powers) != INTSXP) || (length(sx_hasorigin_powers) < UT_MAXNUM_BASE_QUANTITIES+1) )
+		error( "%s (R version): error: I was passed a unit that is NOT of class 'udUnits'!", caller );
+
+	R_ututil_Rstyle_to_utUnit( REAL(sx_origin_factor), INTEGER(sx_hasorigin_powers), tmp );
+	return( tmp );
+}
+
 /******************************************************************/
 /* Converts a formatted units string into a group of two double
  * precisions (origin, factor) and UT_MAXNUM_BASE_QUANTITIES+1
  * integers (hasorigin, then the UT_MAXNUM_BASE_QUANTITIES powers).
- * Return value is 0 on success, not zero otherwise.
+ * Parsed units are cached (see utScan_cache.c), so scanning the
+ * same string again costs about as much as passing an already
+ * scanned unit.  A plain unit name is looked up in the units database
+ * snapshot first, if there is one.
+ * Returns a list like the one the old .C interface gave: the units
+ * string, then 'originfactor', 'hasoriginpowers' (20 integers), and 
+ * 'error', which is 0 on success, not zero otherwise.  On success the
+ * list also has 'ptr', an external pointer to the native utUnit, which
+ * the other entry points use directly (see R_ututil_unit).
  */
-void R_utScan( char **spec, double *origin_factor, int *hasorigin_powers,
-		int *retval )
+SEXP R_utScan_v1p3( SEXP sx_spec )
 {
-	utUnit 	u;
+	utUnit 	u, *up;
+	int	retval;
+	double	t0 = 0.;
+	SEXP	sx_retval, sx_name, sx_origin_factor, sx_hasorigin_powers;
+
+	UDU_STAT_START( t0 );
 
-	if( (*retval = utScan( spec[0], &u )) != 0 ) {
-		if( *retval == UT_ENOINIT ) {
+	PROTECT( sx_retval           = allocVector( VECSXP,  5  ));
+	PROTECT( sx_origin_factor    = allocVector( REALSXP, 2  ));
+	PROTECT( sx_hasorigin_powers = allocVector( INTSXP,  20 ));	/* must be at least UT_MAXNUM_BASE_QUANTITIES+1 */
+	memset( INTEGER(sx_hasorigin_powers), 0, 20*sizeof(int) );
+	memset( REAL(sx_origin_factor), 0, 2*sizeof(double) );
+
+	if( udu_snapshot_lookup( &R_udu_snap, CHAR(STRING_ELT(sx_spec,0)), &u ) == 0 ) {
+		UDU_STAT_EVENT( UDU_STAT_EV_SNAPSHOT_HIT );
+		retval = 0;
+		}
+	else
+		{
+		if( R_udu_snap.base != NULL )
+			UDU_STAT_EVENT( UDU_STAT_EV_SNAPSHOT_MISS );
+		R_ututil_need_lib();
+		retval = utScan_cached( CHAR(STRING_ELT(sx_spec,0)), &u );
+		}
+
+	if( retval != 0 ) {
+		if( retval == UT_ENOINIT ) {
 			fprintf( stderr, "utScan (R version): error: udunits package not initialized yet!\n");
 			fprintf( stderr, "You must call utInit() first.\n" );
-			return;
 			}
 
-		if( *retval == UT_EINVALID ) {
+		else if( retval == UT_EINVALID )
 			fprintf( stderr, "utScan (R version): error: invalid unit argument!\n");
-			return;
-			}
 
-		if( *retval == UT_EUNKNOWN ) {
+		else if( retval == UT_EUNKNOWN )
 			fprintf( stderr, "utScan (R version): error: your specification contains an unknown unit!\n" );
-			return;
-			}
 
-		if( *retval == UT_ESYNTAX ) {
+		else if( retval == UT_ESYNTAX )
 			fprintf( stderr, "utScan (R version): error: your specification contains a syntax error!\n" );
-			return;
+
+		else
+			fprintf( stderr, "utScan (R version): unknown error %d!\n", retval );
+		}
+	else
+		{
+		/* Convert unit to R-style for return, and keep the native one too */
+		R_ututil_utUnit_to_Rstyle( &u, REAL(sx_origin_factor), INTEGER(sx_hasorigin_powers) );
+		SET_VECTOR_ELT( sx_retval, 4, R_ututil_extptr_new( sizeof(utUnit), "utUnit", (void **)&up ));
+		*up = u;
+		}
+
+	SET_VECTOR_ELT( sx_retval, 0, sx_spec );
+	SET_VECTOR_ELT( sx_retval, 1, sx_origin_factor );
+	SET_VECTOR_ELT( sx_retval, 2, sx_hasorigin_powers );
+	SET_VECTOR_ELT( sx_retval, 3, ScalarInteger( retval ));
+
+	PROTECT( sx_name = allocVector( STRSXP, 5 ));
+	SET_STRING_ELT( sx_name, 0, mkChar(""               ) );
+	SET_STRING_ELT( sx_name, 1, mkChar("originfactor"   ) );
+	SET_STRING_ELT( sx_name, 2, mkChar("hasoriginpowers") );
+	SET_STRING_ELT( sx_name, 3, mkChar("error"          ) );
+	SET_STRING_ELT( sx_name, 4, mkChar("ptr"            ) );
+	setAttrib( sx_retval, R_NamesSymbol, sx_name );
+
+	UNPROTECT(4);
+	UDU_STAT_STOP( UDU_STAT_R_SCAN, 1, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Scans a whole character vector of units strings at once, e.g. the
+ * units attributes of every variable in an archive.  Each distinct 
+ * string is scanned once: R keeps one copy of each string (CHARSXP),
+ * so repeats are found by hashing the pointers, with no string 
+ * compares.  Scanning goes through the snapshot and the units cache,
+ * as utScan does.
+ * Input:
+ *	sx_specs: the units strings
+ * Return value: a list of columns, one row per string: 'factor', 
+ *	'origin', 'hasorigin', 'is.time', 'status' (0 on success, else 
+ *	the udunits error code; NA for an NA string), and 'powers', an 
+ *	n x UT_MAXNUM_BASE_QUANTITIES integer matrix.  Rows that failed 
+ *	have NA in every column but 'status'.
+ */
+SEXP R_utScanMany( SEXP sx_specs )
+{
+	utUnit 		u;
+	R_xlen_t	n, i, j, k, hsize, h, *table;
+	int		retval, *hasorigin, *istime, *status, *powers;
+	double		*factor, *origin, t0 = 0.;
+	SEXP		sx_spec, sx_retval, sx_name, sx_powers;
+
+	UDU_STAT_START( t0 );
+
+	if( ! isString( sx_specs ))
+		error( "utScanMany (R version): error: units must be a character vector!" );
+	n = XLENGTH( sx_specs );
+
+	PROTECT( sx_retval = allocVector( VECSXP, 6 ));
+	SET_VECTOR_ELT( sx_retval, 0, allocVector( REALSXP, n ));
+	SET_VECTOR_ELT( sx_retval, 1, allocVector( REALSXP, n ));
+	SET_VECTOR_ELT( sx_retval, 2, allocVector( LGLSXP,  n ));
+	SET_VECTOR_ELT( sx_retval, 3, allocVector( LGLSXP,  n ));
+	SET_VECTOR_ELT( sx_retval, 4, allocVector( INTSXP,  n ));
+	SET_VECTOR_ELT( sx_retval, 5, sx_powers = allocMatrix( INTSXP, n, UT_MAXNUM_BASE_QUANTITIES ));
+	factor    = REAL   ( VECTOR_ELT( sx_retval, 0 ));
+	origin    = REAL   ( VECTOR_ELT( sx_retval, 1 ));
+	hasorigin = LOGICAL( VECTOR_ELT( sx_retval, 2 ));
+	istime    = LOGICAL( VECTOR_ELT( sx_retval, 3 ));
+	status    = INTEGER( VECTOR_ELT( sx_retval, 4 ));
+	powers    = INTEGER( sx_powers );
+
+	/* Open addressing table of the first row with each string, -1 if empty */
+	for( hsize=16; hsize < 2*n; hsize *= 2 )
+		;
+	table = (R_xlen_t *)R_alloc( hsize, sizeof(R_xlen_t) );
+	for( h=0; h<hsize; h++ )
+		table[h] = -1;
+
+	for( i=0; i<n; i++ ) {
+		sx_spec = STRING_ELT( sx_specs, i );
+
+		h = (R_xlen_t)((((size_t)sx_spec >> 4) * 2654435761UL) & (size_t)(hsize-1));
+		while( ((j = table[h]) >= 0) && (STRING_ELT( sx_specs, j ) != sx_spec) )
+			h = (h+1) & (hsize-1);
+
+		if( j >= 0 ) {		/* seen before */
+			factor[i]    = factor[j];
+			origin[i]    = origin[j];
+			hasorigin[i] = hasorigin[j];
+			istime[i]    = istime[j];
+			status[i]    = status[j];
+			for( k=0; k<UT_MAXNUM_BASE_QUANTITIES; k++ )
+				powers[i + k*n] = powers[j + k*n];
+			continue;
 			}
+		table[h] = i;
 
-		fprintf( stderr, "utScan (R version): unknown error %d!\n", *retval );
-		return;
+		if( sx_spec == NA_STRING )
+			retval = NA_INTEGER;
+		else if( udu_snapshot_lookup( &R_udu_snap, CHAR(sx_spec), &u ) == 0 ) {
+			UDU_STAT_EVENT( UDU_STAT_EV_SNAPSHOT_HIT );
+			retval = 0;
+			}
+		else
+			{
+			if( R_udu_snap.base != NULL )
+				UDU_STAT_EVENT( UDU_STAT_EV_SNAPSHOT_MISS );
+			R_ututil_need_lib();
+			retval = utScan_cached( CHAR(sx_spec), &u );
+			}
+
+		status[i] = retval;
+		if( retval != 0 ) {
+			factor[i]    = NA_REAL;
+			origin[i]    = NA_REAL;
+			hasorigin[i] = NA_LOGICAL;
+			istime[i]    = NA_LOGICAL;
+			for( k=0; k<UT_MAXNUM_BASE_QUANTITIES; k++ )
+				powers[i + k*n] = NA_INTEGER;
+			continue;
+			}
+
+		factor[i]    = u.factor;
+		origin[i]    = u.origin;
+		hasorigin[i] = (u.hasorigin != 0);
+		istime[i]    = (R_ututil_utIsTime( &u ) != 0);
+		for( k=0; k<UT_MAXNUM_BASE_QUANTITIES; k++ )
+			powers[i + k*n] = u.power[k];
+		}
+
+	PROTECT( sx_name = allocVector( STRSXP, 6 ));
+	SET_STRING_ELT( sx_name, 0, mkChar("factor"   ) );
+	SET_STRING_ELT( sx_name, 1, mkChar("origin"   ) );
+	SET_STRING_ELT( sx_name, 2, mkChar("hasorigin") );
+	SET_STRING_ELT( sx_name, 3, mkChar("is.time"  ) );
+	SET_STRING_ELT( sx_name, 4, mkChar("status"   ) );
+	SET_STRING_ELT( sx_name, 5, mkChar("powers"   ) );
+	setAttrib( sx_retval, R_NamesSymbol, sx_name );
+
+	UNPROTECT(2);
+	UDU_STAT_STOP( UDU_STAT_R_SCAN_MANY, n, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Returns the units cache's size and hit/miss counts as a named
+ * numeric vector, optionally resetting the counts afterwards.
+ */
+SEXP R_utScan_cache_info( SEXP sx_reset )
+{
+	long	entries, capacity;
+	double	hits, misses;
+	SEXP	sx_retval, sx_name;
+
+	utScan_cache_stats( &entries, &capacity, &hits, &misses );
+	if( asLogical( sx_reset ) == TRUE )
+		utScan_cache_reset_stats();
+
+	PROTECT( sx_retval = allocVector( REALSXP, 4 ));
+	REAL(sx_retval)[0] = (double)entries;
+	REAL(sx_retval)[1] = (double)capacity;
+	REAL(sx_retval)[2] = hits;
+	REAL(sx_retval)[3] = misses;
+
+	PROTECT( sx_name = allocVector( STRSXP, 4 ));
+	SET_STRING_ELT( sx_name, 0, mkChar("entries" ) );
+	SET_STRING_ELT( sx_name, 1, mkChar("capacity") );
+	SET_STRING_ELT( sx_name, 2, mkChar("hits"    ) );
+	SET_STRING_ELT( sx_name, 3, mkChar("misses"  ) );
+	setAttrib( sx_retval, R_NamesSymbol, sx_name );
+
+	UNPROTECT(2);
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Returns the hot-path statistics (see utStats.h) as a list of
+ * columns: name, kind ("entry", "kernel" or "event"), calls, values,
+ * and nanoseconds, which the R code turns into a data.frame.  The
+ * units cache's hits and misses are included as events.  If sx_level
+ * is not NULL, collecting is then set to that level (0 off, 1 counts,
+ * 2 counts and timing); if sx_reset is TRUE, everything is then zeroed.
+ * The level in force when called is returned as attribute "level".
+ */
+SEXP R_utStats( SEXP sx_level, SEXP sx_reset )
+{
+	long	entries, capacity;
+	double	hits, misses;
+	int	i, n;
+	SEXP	sx_retval, sx_name, sx_kind, sx_calls, sx_values, sx_nanosec, sx_names;
+
+	n = UDU_STAT_COUNT + 2;
+	PROTECT( sx_retval  = allocVector( VECSXP,  5 ));
+	PROTECT( sx_name    = allocVector( STRSXP,  n ));
+	PROTECT( sx_kind    = allocVector( STRSXP,  n ));
+	PROTECT( sx_calls   = allocVector( REALSXP, n ));
+	PROTECT( sx_values  = allocVector( REALSXP, n ));
+	PROTECT( sx_nanosec = allocVector( REALSXP, n ));
+
+	for( i=0; i<UDU_STAT_COUNT; i++ ) {
+		SET_STRING_ELT( sx_name, i, mkChar( udu_stats_name( (udu_stat_id)i )));
+		SET_STRING_ELT( sx_kind, i, mkChar( udu_stats_is_event( (udu_stat_id)i ) ? "event" :
+			((i < UDU_STAT_CAL_STANDARD) ? "entry" : "kernel") ));
+		udu_stats_get( (udu_stat_id)i, REAL(sx_calls)+i, REAL(sx_values)+i, REAL(sx_nanosec)+i );
+		}
+
+	utScan_cache_stats( &entries, &capacity, &hits, &misses );
+	SET_STRING_ELT( sx_name, n-2, mkChar("cache.hit" ));
+	SET_STRING_ELT( sx_name, n-1, mkChar("cache.miss"));
+	SET_STRING_ELT( sx_kind, n-2, mkChar("event"));
+	SET_STRING_ELT( sx_kind, n-1, mkChar("event"));
+	REAL(sx_calls)[n-2] = hits;
+	REAL(sx_calls)[n-1] = misses;
+	for( i=n-2; i<n; i++ ) {
+		REAL(sx_values)[i]  = 0.;
+		REAL(sx_nanosec)[i] = 0.;
+		}
+
+	SET_VECTOR_ELT( sx_retval, 0, sx_name    );
+	SET_VECTOR_ELT( sx_retval, 1, sx_kind    );
+	SET_VECTOR_ELT( sx_retval, 2, sx_calls   );
+	SET_VECTOR_ELT( sx_retval, 3, sx_values  );
+	SET_VECTOR_ELT( sx_retval, 4, sx_nanosec );
+
+	PROTECT( sx_names = allocVector( STRSXP, 5 ));
+	SET_STRING_ELT( sx_names, 0, mkChar("name"   ) );
+	SET_STRING_ELT( sx_names, 1, mkChar("kind"   ) );
+	SET_STRING_ELT( sx_names, 2, mkChar("calls"  ) );
+	SET_STRING_ELT( sx_names, 3, mkChar("values" ) );
+	SET_STRING_ELT( sx_names, 4, mkChar("nanosec") );
+	setAttrib( sx_retval, R_NamesSymbol, sx_names );
+	setAttrib( sx_retval, install("level"), ScalarInteger( udu_stats_level ));
+
+	if( ! isNull( sx_level )) {
+		if( (asInteger( sx_level ) == NA_INTEGER) || (asInteger( sx_level ) < UDU_STATS_OFF) 
+				|| (asInteger( sx_level ) > UDU_STATS_TIMING) )
+			error( "utStats (R version): error: level must be 0, 1 or 2!" );
+		udu_stats_set_level( asInteger( sx_level ));
 		}
 
-	/* Convert unit to R-style for return */
-	R_ututil_utUnit_to_Rstyle( &u, origin_factor, hasorigin_powers );
+	if( asLogical( sx_reset ) == TRUE ) {
+		udu_stats_reset();
+		utScan_cache_reset_stats();
+		}
+
+	UNPROTECT(7);
+	return( sx_retval );
 }
 
 /******************************************************************/
 /* Inputs:
  *	sx_value: guaranteed to be a double (could be >1)
  *		calendar date.
- *	sx_origin_factor, sx_hasorigin_powers: describe the 
- * 		udunits-processed time unit.
- * 	calendar: either 'standard', 'noleap', or '360_day'
+ *	sx_unit: the time unit, a 'udUnits' object from utScan
+ * 	calendar: the name of the calendar, e.g. 'standard' or 'noleap'
+ *	sx_fill: NULL, or double fill values, which are taken as missing
  *
  * Return value:
  * 	If only 1 value is passed, then returns an object of class "utDate"
@@ -156,267 +731,1120 @@ void R_utScan( char **spec, double *origin_factor, int *hasorigin_powers,
  *		style=2: returns a list with year, month, day, hour, minute, second, each
  *			of which is an array of length n,
  *		where n is the number of values passed in.
+ *	Either way the dates are decoded into the style=2 arrays; for style=1
+ *	the list of utDate objects is a view of those arrays (see utDateList.c),
+ *	so no per-date R objects are made until they are used.
+ *	Values that are NA, NaN, or fill values, or that are out of range, 
+ *	give dates that are all NA, and do not stop the others being decoded.
+ *	If more than 1 value is passed, the result has an integer attribute
+ *	"status", 0 for each value decoded, 1 for missing, 3 for out of range.
  */
-SEXP R_utCalendar_v1p3( SEXP sx_value, SEXP sx_origin_factor, SEXP sx_hasorigin_powers, SEXP sx_style,
-	SEXP sx_calendar )
+SEXP R_utCalendar_v1p3( SEXP sx_value, SEXP sx_unit, SEXP sx_style, SEXP sx_calendar, SEXP sx_fill )
 {
-	utUnit 	u;
-	int 	i, nvals, retval, *hasorigin_powers, year, month, day, hour, minute, *style;
-	float	second;
-	double	*origin_factor, *value;
-	char	*calendar;
-	SEXP	sx_big_retval, sx_single_retval, sx_year, sx_month, sx_day, sx_hour, sx_minute, 
-		sx_name, sx_second, sx_retarr_year, sx_retarr_month, sx_retarr_day, sx_retarr_hour,
-		sx_retarr_minute, sx_retarr_second, sx_calendar_elt;
+	utUnit 	utmp, *u;
+	int 	nvals, retval, *style, nfill, status;
+	int	year, month, day, hour, minute;
+	double	*value, second, *fill, t0 = 0., t0_build = 0.;
+	SEXP	sx_retval, sx_name, sx_retarr_year, sx_retarr_month, sx_retarr_day, sx_retarr_hour,
+		sx_retarr_minute, sx_retarr_second, sx_status;
+
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
 
 	nvals = length( sx_value );
 	if( nvals < 1 ) 
 		error( "utCalendar_v1p3 (R version): error: passed funny # of vals to convert: %d\n", nvals );
 
 	value            = REAL(sx_value);
-	origin_factor    = REAL(sx_origin_factor);
-	hasorigin_powers = INTEGER(sx_hasorigin_powers);
 	style            = INTEGER(sx_style);
-	sx_calendar_elt	 = STRING_ELT(sx_calendar,0);
-	calendar	 = CHAR(sx_calendar_elt);
-
-	R_ututil_Rstyle_to_utUnit( origin_factor, hasorigin_powers, &u );
-
-	/* If we are doing multiple entries, make our return object(s) */
-	if( nvals > 1 ) {
-
-		if( *style == 1 ) 
-			PROTECT( sx_big_retval = allocVector( VECSXP, nvals )); /* a list that will hold utDate objects */
-
-		else if(*style == 2 ) {
-			PROTECT( sx_retarr_year   = allocVector( INTSXP,  nvals ));
-			PROTECT( sx_retarr_month  = allocVector( INTSXP,  nvals ));
-			PROTECT( sx_retarr_day    = allocVector( INTSXP,  nvals ));
-			PROTECT( sx_retarr_hour   = allocVector( INTSXP,  nvals ));
-			PROTECT( sx_retarr_minute = allocVector( INTSXP,  nvals ));
-			PROTECT( sx_retarr_second = allocVector( REALSXP, nvals ));
-
-			PROTECT( sx_single_retval = allocVector( VECSXP, 6 )); /* a list that has year, mo, day, etc, each of which are arrays */
-
-			SET_VECTOR_ELT( sx_single_retval, 0, sx_retarr_year   );
-			SET_VECTOR_ELT( sx_single_retval, 1, sx_retarr_month  );
-			SET_VECTOR_ELT( sx_single_retval, 2, sx_retarr_day    );
-			SET_VECTOR_ELT( sx_single_retval, 3, sx_retarr_hour   );
-			SET_VECTOR_ELT( sx_single_retval, 4, sx_retarr_minute );
-			SET_VECTOR_ELT( sx_single_retval, 5, sx_retarr_second );
-
-			/* Elements are now part of a protected element, so they don't need protection */
-			UNPROTECT(6);	/* sx_retarr_year, sx_retarr_month, sx_retarr_day, sx_retarr_hour, sx_retarr_minute, sx_retarr_second */
-
-			/* Set our names */
-			PROTECT( sx_name = allocVector( STRSXP, 6 ));
-			SET_STRING_ELT( sx_name, 0, mkChar("year"  ) );
-			SET_STRING_ELT( sx_name, 1, mkChar("month" ) );
-			SET_STRING_ELT( sx_name, 2, mkChar("day"   ) );
-			SET_STRING_ELT( sx_name, 3, mkChar("hour"  ) );
-			SET_STRING_ELT( sx_name, 4, mkChar("minute") );
-			SET_STRING_ELT( sx_name, 5, mkChar("second") );
-			setAttrib( sx_single_retval, R_NamesSymbol, sx_name );
-			UNPROTECT(1);	/* done with sx_name */
-			}
 
-		else
-			error( "utCalendar_v1p3 (R version): error: passed unknown style, only 1 or 2 recognized!\n" );
+	if( (nvals > 1) && (*style != 1) && (*style != 2) )
+		error( "utCalendar_v1p3 (R version): error: passed unknown style, only 1 or 2 recognized!\n" );
+
+	u = R_ututil_unit( sx_unit, &utmp, "utCalendar" );
+
+	nfill = isNull( sx_fill ) ? 0 : length( sx_fill );
+	fill  = (nfill > 0) ? REAL( sx_fill ) : NULL;
+
+	/* A single value comes back as one utDate object */
+	if( nvals == 1 ) {
+		retval = utCalendar_cal_batch_status( &R_udu_cal_ctx, value, 1, u, R_ututil_calendar_id( sx_calendar ),
+			fill, nfill, &year, &month, &day, &hour, &minute, &second, &status, NA_INTEGER, NA_REAL );
+		R_ututil_calendar_error( retval );
+		UDU_STAT_START( t0_build );
+		sx_retval = R_utDate_make( year, month, day, hour, minute, second );
+		UDU_STAT_STOP( UDU_STAT_R_CALENDAR_BUILD, 1, t0_build );
+		UDU_STAT_STOP( UDU_STAT_R_CALENDAR, 1, t0 );
+		return( sx_retval );
 		}
 
-	for( i=0; i<nvals; i++ ) {
-		if( (retval = utCalendar_cal( *(value+i), &u, &year, &month,
-				&day, &hour, &minute, &second, calendar )) != 0 ) {
-			if( retval == UT_ENOINIT ) 
-				error( "utCalendar (R version): error: udunits package not initialized yet!  You must call utInit() first." );
+	UDU_STAT_START( t0_build );
+	PROTECT( sx_retarr_year   = allocVector( INTSXP,  nvals ));
+	PROTECT( sx_retarr_month  = allocVector( INTSXP,  nvals ));
+	PROTECT( sx_retarr_day    = allocVector( INTSXP,  nvals ));
+	PROTECT( sx_retarr_hour   = allocVector( INTSXP,  nvals ));
+	PROTECT( sx_retarr_minute = allocVector( INTSXP,  nvals ));
+	PROTECT( sx_retarr_second = allocVector( REALSXP, nvals ));
 
-			else if( retval == UT_EINVALID )
-				error( "utCalendar (R version): error: units are not time-like!" );
+	PROTECT( sx_retval = allocVector( VECSXP, 6 )); /* a list that has year, mo, day, etc, each of which are arrays */
 
-			else
-				error( "utCalendar (R version): unknown error %d!\n", retval );
-			}
+	SET_VECTOR_ELT( sx_retval, 0, sx_retarr_year   );
+	SET_VECTOR_ELT( sx_retval, 1, sx_retarr_month  );
+	SET_VECTOR_ELT( sx_retval, 2, sx_retarr_day    );
+	SET_VECTOR_ELT( sx_retval, 3, sx_retarr_hour   );
+	SET_VECTOR_ELT( sx_retval, 4, sx_retarr_minute );
+	SET_VECTOR_ELT( sx_retval, 5, sx_retarr_second );
+
+	/* Set our names */
+	PROTECT( sx_name = allocVector( STRSXP, 6 ));
+	SET_STRING_ELT( sx_name, 0, mkChar("year"  ) );
+	SET_STRING_ELT( sx_name, 1, mkChar("month" ) );
+	SET_STRING_ELT( sx_name, 2, mkChar("day"   ) );
+	SET_STRING_ELT( sx_name, 3, mkChar("hour"  ) );
+	SET_STRING_ELT( sx_name, 4, mkChar("minute") );
+	SET_STRING_ELT( sx_name, 5, mkChar("second") );
+	setAttrib( sx_retval, R_NamesSymbol, sx_name );
+	UDU_STAT_STOP( UDU_STAT_R_CALENDAR_BUILD, nvals, t0_build );
+
+	/*-----------------------------------------------------------------------
+	 * Decode all the values in one call, with the calendar name resolved
+	 * only once, straight into the returned arrays.
+	 *----------------------------------------------------------------------*/
+	PROTECT( sx_status = allocVector( INTSXP, nvals ));
+	retval = utCalendar_cal_batch_status( &R_udu_cal_ctx, value, nvals, u, R_ututil_calendar_id( sx_calendar ), 
+			fill, nfill, INTEGER(sx_retarr_year), INTEGER(sx_retarr_month), INTEGER(sx_retarr_day),
+			INTEGER(sx_retarr_hour), INTEGER(sx_retarr_minute), REAL(sx_retarr_second), 
+			INTEGER(sx_status), NA_INTEGER, NA_REAL );
+	R_ututil_calendar_error( retval );
+
+	if( *style == 1 ) {
+		UDU_STAT_START( t0_build );
+		sx_retval = R_utDateList_make( sx_retval );
+		UDU_STAT_STOP( UDU_STAT_R_CALENDAR_BUILD, 0, t0_build );
+		}
+	PROTECT( sx_retval );
+	setAttrib( sx_retval, install("status"), sx_status );
+
+	UNPROTECT(10);
+	UDU_STAT_STOP( UDU_STAT_R_CALENDAR, nvals, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Converts values of a time unit straight into one of R's time 
+ * classes, with no dates in between (see utCalendar_cal_unix_batch).
+ * Inputs:
+ *	sx_value: double values of the time unit
+ *	sx_unit: the time unit, a 'udUnits' object from utScan
+ *	sx_calendar: the calendar the values are on
+ *	sx_style: "POSIXct" for seconds since 1970-01-01 00:00:00 UTC,
+ *		"Date" for days since 1970-01-01, or "int64" for 
+ *		nanoseconds since 1970-01-01 00:00:00 UTC, as the bit64
+ *		package's class "integer64"
+ *	sx_fill: NULL, or double fill values, which are taken as missing
+ * Return value: a double vector as long as sx_value with the class,
+ *	NA where the value is NA or a fill value, or the date has no 
+ *	equivalent.
+ */
+SEXP R_utCalendarUnix( SEXP sx_value, SEXP sx_unit, SEXP sx_calendar, SEXP sx_style, SEXP sx_fill )
+{
+	utUnit 		utmp, *u;
+	udu_unix_style	style;
+	const char	*style_name;
+	R_xlen_t	nvals, i;
+	int		retval, j, nfill;
+	double		*value, *fill, t0 = 0.;
+	SEXP		sx_retval, sx_class;
 
-		if( (nvals==1) || (*style==1) ) {
-			/* Make this individual entry's utDate object */
-			PROTECT( sx_single_retval = allocVector( VECSXP, 6 ));
-
-			PROTECT( sx_year   = allocVector( INTSXP,  1 )); INTEGER(sx_year  )[0] = year;
-			PROTECT( sx_month  = allocVector( INTSXP,  1 )); INTEGER(sx_month )[0] = month;
-			PROTECT( sx_day    = allocVector( INTSXP,  1 )); INTEGER(sx_day   )[0] = day;
-			PROTECT( sx_hour   = allocVector( INTSXP,  1 )); INTEGER(sx_hour  )[0] = hour;
-			PROTECT( sx_minute = allocVector( INTSXP,  1 )); INTEGER(sx_minute)[0] = minute;
-			PROTECT( sx_second = allocVector( REALSXP, 1 )); REAL   (sx_second)[0] = second;
-
-			SET_VECTOR_ELT( sx_single_retval, 0, sx_year   );
-			SET_VECTOR_ELT( sx_single_retval, 1, sx_month  );
-			SET_VECTOR_ELT( sx_single_retval, 2, sx_day    );
-			SET_VECTOR_ELT( sx_single_retval, 3, sx_hour   );
-			SET_VECTOR_ELT( sx_single_retval, 4, sx_minute );
-			SET_VECTOR_ELT( sx_single_retval, 5, sx_second );
-
-			/* Elements are now part of a protected element, so they don't need protection */
-			UNPROTECT(6);	/* sx_year, sx_month, sx_day, sx_hour, sx_minute, sx_second */
-
-			/* Set our names */
-			PROTECT( sx_name = allocVector( STRSXP, 6 ));
-			SET_STRING_ELT( sx_name, 0, mkChar("year"  ) );
-			SET_STRING_ELT( sx_name, 1, mkChar("month" ) );
-			SET_STRING_ELT( sx_name, 2, mkChar("day"   ) );
-			SET_STRING_ELT( sx_name, 3, mkChar("hour"  ) );
-			SET_STRING_ELT( sx_name, 4, mkChar("minute") );
-			SET_STRING_ELT( sx_name, 5, mkChar("second") );
-			setAttrib( sx_single_retval, R_NamesSymbol, sx_name );
-			UNPROTECT(1);	/* done with sx_name */
-
-			/* Set our class name */
-			PROTECT( sx_name = allocVector( STRSXP, 1 ));
-			SET_STRING_ELT( sx_name, 0, mkChar("utDate"));
-			setAttrib( sx_single_retval, R_ClassSymbol, sx_name );
-			UNPROTECT(1);   /* done with sx_name */
-
-			/* If only 1 value to convert, we are all done now! */
-			if( nvals == 1 ) {
-				UNPROTECT(1);
-				return(sx_single_retval);
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
+
+	u = R_ututil_unit( sx_unit, &utmp, "utCalendar" );
+	style_name = CHAR(STRING_ELT(sx_style,0));
+	if( strcmp( style_name, "POSIXct" ) == 0 )
+		style = UDU_UNIX_SECONDS;
+	else if( strcmp( style_name, "Date" ) == 0 )
+		style = UDU_UNIX_DAYS;
+	else if( strcmp( style_name, "int64" ) == 0 )
+		style = UDU_UNIX_NANOSECONDS;
+	else
+		error( "utCalendar (R version): Unrecognized style >%s<.  Recognized values: list, array, POSIXct, Date, int64.",
+			style_name );
+
+	nvals = XLENGTH( sx_value );
+	PROTECT( sx_retval = allocVector( REALSXP, nvals ));
+	retval = utCalendar_cal_unix_batch( &R_udu_cal_ctx, REAL(sx_value), nvals, u, 
+			R_ututil_calendar_id( sx_calendar ), style, REAL(sx_retval) );
+	R_ututil_calendar_error( retval );
+
+	/* NaN is already NA; fill values are made NA afterwards */
+	nfill = isNull( sx_fill ) ? 0 : length( sx_fill );
+	fill  = (nfill > 0) ? REAL( sx_fill ) : NULL;
+	value = REAL( sx_value );
+	for( i=0; (nfill > 0) && (i<nvals); i++ )
+		for( j=0; j<nfill; j++ )
+			if( value[i] == fill[j] ) {
+				if( style == UDU_UNIX_NANOSECONDS )
+					((int64_t *)REAL(sx_retval))[i] = INT64_MIN;
+				else
+					REAL(sx_retval)[i] = NA_REAL;
 				}
 
-			/* ...otherwise, add this new utDate to the list we are accumulating */
-			SET_VECTOR_ELT( sx_big_retval, i, sx_single_retval );
-			UNPROTECT(1);	/* sx_single_retval is now protected by its parent */
+	if( style == UDU_UNIX_SECONDS ) {
+		PROTECT( sx_class = allocVector( STRSXP, 2 ));
+		SET_STRING_ELT( sx_class, 0, mkChar("POSIXct") );
+		SET_STRING_ELT( sx_class, 1, mkChar("POSIXt" ) );
+		setAttrib( sx_retval, install("tzone"), mkString("UTC") );
+		}
+	else
+		PROTECT( sx_class = mkString( (style == UDU_UNIX_DAYS) ? "Date" : "integer64" ));
+	setAttrib( sx_retval, R_ClassSymbol, sx_class );
+
+	UNPROTECT(2);
+	UDU_STAT_STOP( UDU_STAT_R_CALENDAR, nvals, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Decodes values of a time unit into dates and formats them as text,
+ * in one pass, with no utDate objects in between.  The values are
+ * decoded a block at a time into small arrays, which are formatted
+ * straight into the returned character vector.
+ * Inputs:
+ *	sx_value: double values of the time unit
+ *	sx_unit: the time unit, a 'udUnits' object from utScan
+ *	sx_format: the layout, "full", "slashes", "unix", "sci",
+ *		"underscore" or "iso"
+ *	sx_calendar: the calendar the dates are on
+ *	sx_digits: decimal places of the seconds in the "iso" layout
+ * Return value: a character vector as long as sx_value, with NA 
+ *	where the value is NA or not finite.
+ */
+#define R_UDU_FORMAT_BLOCK	1024
+
+SEXP R_utFormatDate( SEXP sx_value, SEXP sx_unit, SEXP sx_format, SEXP sx_calendar, SEXP sx_digits )
+{
+	utUnit 		utmp, *u;
+	udu_calendar_id	cal_id;
+	udu_date_format	fmt;
+	R_xlen_t	nvals, i0, i;
+	int		k, nblock, retval, digits, len;
+	int		year[R_UDU_FORMAT_BLOCK], month[R_UDU_FORMAT_BLOCK], day[R_UDU_FORMAT_BLOCK], 
+			hour[R_UDU_FORMAT_BLOCK], minute[R_UDU_FORMAT_BLOCK], status[R_UDU_FORMAT_BLOCK];
+	double		second[R_UDU_FORMAT_BLOCK], *value, t0 = 0.;
+	char		buf[UDU_FMT_MAXLEN];
+	SEXP		sx_retval;
+
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
+
+	u      = R_ututil_unit( sx_unit, &utmp, "utFormatDate" );
+	cal_id = R_ututil_calendar_id( sx_calendar );
+	digits = asInteger( sx_digits );
+	if( (digits == NA_INTEGER) || (digits < 0) || (digits > 9) )
+		error( "utFormatDate (R version): error: digits must be between 0 and 9!" );
+	if( (fmt = udu_date_format_id( CHAR(STRING_ELT(sx_format,0)) )) == UDU_FMT_UNKNOWN )
+		error( "utFormatDate (R version): Unrecognized format >%s<.  Recognized values: full, slashes, unix, sci, underscore, iso.",
+			CHAR(STRING_ELT(sx_format,0)) );
+
+	nvals = XLENGTH( sx_value );
+	value = REAL( sx_value );
+	PROTECT( sx_retval = allocVector( STRSXP, nvals ));
+
+	for( i0=0; i0<nvals; i0 += R_UDU_FORMAT_BLOCK ) {
+		nblock = (nvals - i0 < R_UDU_FORMAT_BLOCK) ? (int)(nvals - i0) : R_UDU_FORMAT_BLOCK;
+
+		/* Missing values, and those too far from the reference date, come out as NA */
+		retval = utCalendar_cal_batch_status( &R_udu_cal_ctx, value+i0, nblock, u, cal_id, NULL, 0,
+				year, month, day, hour, minute, second, status, NA_INTEGER, NA_REAL );
+		R_ututil_calendar_error( retval );
+
+		for( k=0, i=i0; k<nblock; k++, i++ ) {
+			if( status[k] != UDU_VALUE_OK )
+				SET_STRING_ELT( sx_retval, i, NA_STRING );
+			else
+				{
+				len = udu_format_date( buf, fmt, cal_id, year[k], month[k], day[k], hour[k], 
+						minute[k], second[k], digits );
+				SET_STRING_ELT( sx_retval, i, mkCharLen( buf, len ));
+				}
 			}
-		else
-			{
-			/* style == 2 */
-			INTEGER(sx_retarr_year  )[i] = year;
-			INTEGER(sx_retarr_month )[i] = month;
-			INTEGER(sx_retarr_day   )[i] = day;
-			INTEGER(sx_retarr_hour  )[i] = hour;
-			INTEGER(sx_retarr_minute)[i] = minute;
-			REAL   (sx_retarr_second)[i] = second;
+		}
+
+	UNPROTECT(1);
+	UDU_STAT_STOP( UDU_STAT_R_FORMAT_DATE, nvals, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Parses date and time strings (see utDateParse.c) and converts them
+ * to values of a time unit, in one pass: the strings are parsed a block
+ * at a time into small arrays of fields, which are converted straight 
+ * into the returned vector.
+ * Inputs:
+ *	sx_dates: a character vector of dates
+ *	sx_unit: the time unit, a 'udUnits' object from utScan
+ *	sx_calendar: the calendar the dates are on
+ * Return value: a double vector as long as sx_dates, NA where a string
+ *	could not be parsed, with attribute "status" giving the UDU_PARSE
+ *	code of each string (0 for success).
+ */
+#define R_UDU_PARSE_BLOCK	1024
+
+SEXP R_utParseDate( SEXP sx_dates, SEXP sx_unit, SEXP sx_calendar )
+{
+	utUnit 		utmp, *u;
+	udu_calendar_id	cal_id;
+	R_xlen_t	ndates, i0, i;
+	int		k, nblock, retval, *status;
+	int		year[R_UDU_PARSE_BLOCK], month[R_UDU_PARSE_BLOCK], day[R_UDU_PARSE_BLOCK], 
+			hour[R_UDU_PARSE_BLOCK], minute[R_UDU_PARSE_BLOCK];
+	double		second[R_UDU_PARSE_BLOCK], *value, t0 = 0.;
+	SEXP		sx_retval, sx_status, sx_str;
+
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
+
+	if( ! isString( sx_dates ))
+		error( "utParseDate (R version): error: dates must be a character vector!" );
+	u      = R_ututil_unit( sx_unit, &utmp, "utParseDate" );
+	cal_id = R_ututil_calendar_id( sx_calendar );
+
+	ndates = XLENGTH( sx_dates );
+	PROTECT( sx_retval = allocVector( REALSXP, ndates ));
+	PROTECT( sx_status = allocVector( INTSXP,  ndates ));
+	value  = REAL( sx_retval );
+	status = INTEGER( sx_status );
+
+	for( i0=0; i0<ndates; i0 += R_UDU_PARSE_BLOCK ) {
+		nblock = (ndates - i0 < R_UDU_PARSE_BLOCK) ? (int)(ndates - i0) : R_UDU_PARSE_BLOCK;
+
+		for( k=0, i=i0; k<nblock; k++, i++ ) {
+			sx_str = STRING_ELT( sx_dates, i );
+			if( sx_str == NA_STRING )
+				status[i] = UDU_PARSE_MISSING;
+			else
+				status[i] = udu_parse_date( CHAR(sx_str), cal_id, year+k, month+k, day+k, 
+						hour+k, minute+k, second+k );
+
+			/* Failed entries are converted as a harmless date, then set to NA */
+			if( status[i] != UDU_PARSE_OK ) {
+				year[k]   = 2001;
+				month[k]  = 1;
+				day[k]    = 1;
+				hour[k]   = 0;
+				minute[k] = 0;
+				second[k] = 0.;
+				}
 			}
+
+		retval = utInvCalendar_cal_batch( &R_udu_cal_ctx, year, month, day, hour, minute, second, 
+				nblock, u, cal_id, value+i0 );
+		if( retval == UT_EINVALID )
+			error( "utParseDate (R version): error: units are not temporal!" );
+		else if( retval != 0 )
+			R_ututil_calendar_error( retval );
+
+		for( k=0, i=i0; k<nblock; k++, i++ )
+			if( status[i] != UDU_PARSE_OK )
+				value[i] = NA_REAL;
 		}
 
-	/* NOTE! if nvals==1, we exit ABOVE, not here */
-	if( *style == 1 ) {
+	setAttrib( sx_retval, install("status"), sx_status );
+
+	UNPROTECT(2);
+	UDU_STAT_STOP( UDU_STAT_R_PARSE_DATE, ndates, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Groups time values into calendar bins, and optionally reduces data
+ * over the bins (see utCalendarBins.c).
+ * Inputs:
+ *	sx_value: double values of the time unit
+ *	sx_unit: the time unit, a 'udUnits' object from utScan
+ *	sx_calendar: the calendar the dates are on
+ *	sx_by: what to bin by, e.g. "month" or "season"
+ *	sx_data: NULL, or a double vector holding m values for each of
+ *		the time values, with time varying slowest
+ *	sx_fun: how to reduce the data: "mean", "sum", "min" or "max"
+ * Return value: if sx_data is NULL, an integer vector with the bin key
+ *	of each value (NA for NA values).  Otherwise a list with 'key',
+ *	the keys of the bins that have any time values, in order; 'n', the
+ *	number of time values in each; and 'value', the m reduced values of
+ *	each bin, bin varying slowest.
+ */
+SEXP R_utCalendarBins( SEXP sx_value, SEXP sx_unit, SEXP sx_calendar, SEXP sx_by, SEXP sx_data, SEXP sx_fun )
+{
+	utUnit 		utmp, *u;
+	udu_calendar_id	cal_id;
+	udu_bin_kind	kind;
+	udu_reduce_op	op;
+	R_xlen_t	nvals, m, b, nb;
+	int		*key, keymin, keymax, retval;
+	double		*result, *count, *nsteps, t0 = 0.;
+	size_t		nbins;
+	SEXP		sx_key, sx_retval, sx_okey, sx_n, sx_oval, sx_names;
+
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
+
+	u      = R_ututil_unit( sx_unit, &utmp, "utCalendarBins" );
+	cal_id = R_ututil_calendar_id( sx_calendar );
+	if( (kind = udu_bin_kind_id( CHAR(STRING_ELT(sx_by,0)) )) == UDU_BIN_UNKNOWN )
+		error( "utCalendarBins (R version): Unrecognized bin >%s<.  Recognized values: year, month, yearmonth, season, yearseason, doy, pentad, dow.",
+			CHAR(STRING_ELT(sx_by,0)) );
+
+	nvals = XLENGTH( sx_value );
+	PROTECT( sx_key = allocVector( INTSXP, nvals ));
+	key = INTEGER( sx_key );
+
+	retval = udu_bin_keys( &R_udu_cal_ctx, REAL(sx_value), nvals, u, cal_id, kind, key, NA_INTEGER );
+	R_ututil_calendar_error( retval );
+
+	if( isNull( sx_data )) {
 		UNPROTECT(1);
-		return( sx_big_retval );
+		UDU_STAT_STOP( UDU_STAT_R_CALENDAR_BINS, nvals, t0 );
+		return( sx_key );
 		}
+
+	if( (op = udu_reduce_op_id( CHAR(STRING_ELT(sx_fun,0)) )) == UDU_REDUCE_UNKNOWN )
+		error( "utCalendarBins (R version): Unrecognized function >%s<.  Recognized values: mean, sum, min, max.",
+			CHAR(STRING_ELT(sx_fun,0)) );
+	if( (nvals == 0) || (XLENGTH( sx_data ) % nvals != 0) )
+		error( "utCalendarBins (R version): error: length of data (%.0f) is not a multiple of the number of time values (%.0f)!",
+			(double)XLENGTH( sx_data ), (double)nvals );
+	m = XLENGTH( sx_data ) / nvals;
+
+	/* The reduction works on every bin from the smallest key to the largest;
+	 * only those with any time values are returned.
+	 */
+	keymin = keymax = 0;
+	if( udu_bin_range( key, nvals, NA_INTEGER, &keymin, &keymax ) == 0 )
+		nbins = 0;
 	else
-		{
+		nbins = (size_t)((double)keymax - (double)keymin) + 1;
+	if( (double)nbins * (double)m > 1e9 )
+		error( "utCalendarBins (R version): error: %.0f bins of %.0f values is too many!", (double)nbins, (double)m );
+
+	result = (double *)R_alloc( nbins*m + 1, sizeof(double) );
+	count  = (double *)R_alloc( nbins*m + 1, sizeof(double) );
+	nsteps = (double *)R_alloc( nbins + 1,   sizeof(double) );
+	udu_bin_reduce( key, nvals, NA_INTEGER, REAL(sx_data), m, op, keymin, nbins, result, count, nsteps, NA_REAL );
+
+	for( nb=0, b=0; b<(R_xlen_t)nbins; b++ )
+		if( nsteps[b] > 0. )
+			nb++;
+
+	PROTECT( sx_okey = allocVector( INTSXP,  nb   ));
+	PROTECT( sx_n    = allocVector( INTSXP,  nb   ));
+	PROTECT( sx_oval = allocVector( REALSXP, nb*m ));
+	for( nb=0, b=0; b<(R_xlen_t)nbins; b++ ) {
+		if( nsteps[b] == 0. )
+			continue;
+		INTEGER(sx_okey)[nb] = keymin + (int)b;
+		INTEGER(sx_n)[nb]    = (int)nsteps[b];
+		memcpy( REAL(sx_oval) + nb*m, result + b*m, m*sizeof(double) );
+		nb++;
+		}
+
+	PROTECT( sx_retval = allocVector( VECSXP, 3 ));
+	SET_VECTOR_ELT( sx_retval, 0, sx_okey );
+	SET_VECTOR_ELT( sx_retval, 1, sx_n    );
+	SET_VECTOR_ELT( sx_retval, 2, sx_oval );
+
+	PROTECT( sx_names = allocVector( STRSXP, 3 ));
+	SET_STRING_ELT( sx_names, 0, mkChar("key"  ) );
+	SET_STRING_ELT( sx_names, 1, mkChar("n"    ) );
+	SET_STRING_ELT( sx_names, 2, mkChar("value") );
+	setAttrib( sx_retval, R_NamesSymbol, sx_names );
+
+	UNPROTECT(6);
+	UDU_STAT_STOP( UDU_STAT_R_CALENDAR_BINS, nvals, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Maps time values from one unit and calendar to another (see
+ * utCalendarRemap.c).
+ * Inputs:
+ *	sx_value: double values of the old time unit
+ *	sx_from_unit, sx_from_calendar: the old time unit, a 'udUnits'
+ *		object from utScan, and the calendar the values are on
+ *	sx_to_unit, sx_to_calendar: the new time unit and calendar
+ *	sx_policy: what to do with dates not on the new calendar: 
+ *		"drop", "clamp", or "proportional"
+ * Return value: the values of the new time unit, NA where there is
+ *	none, with a logical attribute "valid" that is TRUE where there is.
+ */
+SEXP R_utCalendarRemap( SEXP sx_value, SEXP sx_from_unit, SEXP sx_from_calendar, SEXP sx_to_unit, 
+			SEXP sx_to_calendar, SEXP sx_policy )
+{
+	utUnit 			ftmp, ttmp, *from_unit, *to_unit;
+	udu_calendar_id		from_cal, to_cal;
+	udu_remap_policy	policy;
+	R_xlen_t		nvals;
+	int			retval;
+	double			t0 = 0.;
+	SEXP			sx_retval, sx_valid;
+
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
+
+	from_unit = R_ututil_unit( sx_from_unit, &ftmp, "utCalendarRemap" );
+	to_unit   = R_ututil_unit( sx_to_unit,   &ttmp, "utCalendarRemap" );
+	from_cal  = R_ututil_calendar_id( sx_from_calendar );
+	to_cal    = R_ututil_calendar_id( sx_to_calendar );
+	if( (policy = udu_remap_policy_id( CHAR(STRING_ELT(sx_policy,0)) )) == UDU_REMAP_UNKNOWN )
+		error( "utCalendarRemap (R version): Unrecognized policy >%s<.  Recognized values: drop, clamp, proportional.",
+			CHAR(STRING_ELT(sx_policy,0)) );
+
+	nvals = XLENGTH( sx_value );
+	PROTECT( sx_retval = allocVector( REALSXP, nvals ));
+	PROTECT( sx_valid  = allocVector( LGLSXP,  nvals ));
+
+	retval = udu_calendar_remap( &R_udu_cal_ctx, REAL(sx_value), nvals, from_unit, from_cal, to_unit, to_cal,
+			policy, REAL(sx_retval), LOGICAL(sx_valid), NA_REAL );
+	if( retval == UT_EINVALID )
+		error( "utCalendarRemap (R version): error: units are not temporal!" );
+	R_ututil_calendar_error( retval );
+
+	setAttrib( sx_retval, install("valid"), sx_valid );
+
+	UNPROTECT(2);
+	UDU_STAT_STOP( UDU_STAT_R_CALENDAR_REMAP, nvals, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Opens a file of time values for utCalendarStream, raising an R
+ * error if it can't be.
+ */
+static void R_ututil_stream_open( udu_stream *st, SEXP sx_file, SEXP sx_type, SEXP sx_endian, SEXP sx_skip )
+{
+	udu_stream_type	type;
+	const char	*endian;
+	double		skip;
+	int		err;
+
+	if( (type = udu_stream_type_id( CHAR(STRING_ELT(sx_type,0)) )) == UDU_STREAM_UNKNOWN )
+		error( "utCalendarStream (R version): Unrecognized type >%s<.  Recognized values: float64, int32, int64.",
+			CHAR(STRING_ELT(sx_type,0)) );
+	endian = CHAR(STRING_ELT(sx_endian,0));
+	if( (strcmp( endian, "little" ) != 0) && (strcmp( endian, "big" ) != 0) )
+		error( "utCalendarStream (R version): Unrecognized endian >%s<.  Recognized values: little, big.", endian );
+	if( ! ((skip = asReal( sx_skip )) >= 0.) )
+		error( "utCalendarStream (R version): error: skip must be 0 or more!" );
+
+	if( (err = udu_stream_open( st, CHAR(STRING_ELT(sx_file,0)), type, strcmp( endian, "big" ) == 0, 
+			(size_t)skip )) != 0 )
+		error( "utCalendarStream (R version): error: could not open %s: %s", 
+			CHAR(STRING_ELT(sx_file,0)), strerror(err) );
+}
+
+/******************************************************************/
+/* Returns the udu_bin_kind named in sx_by, or -1 if sx_by is NULL
+ * (for dates rather than bin keys).
+ */
+static int R_ututil_stream_kind( SEXP sx_by )
+{
+	udu_bin_kind	kind;
+
+	if( isNull( sx_by ))
+		return( -1 );
+	if( (kind = udu_bin_kind_id( CHAR(STRING_ELT(sx_by,0)) )) == UDU_BIN_UNKNOWN )
+		error( "utCalendarStream (R version): Unrecognized bin >%s<.  Recognized values: year, month, yearmonth, season, yearseason, doy, pentad, dow.",
+			CHAR(STRING_ELT(sx_by,0)) );
+	return( (int)kind );
+}
+
+/******************************************************************/
+/* Decodes a whole file of time values (see utCalendarStream.c) and
+ * writes the dates, or their bin keys, to another file in columns.
+ * Inputs:
+ *	sx_file: name of the file of time values
+ *	sx_type, sx_endian: "float64", "int32", or "int64"; and "little"
+ *		or "big", the byte order of the values
+ *	sx_skip: number of bytes of header before the first value
+ *	sx_unit, sx_calendar: the time unit, a 'udUnits' object from
+ *		utScan, and the calendar the values are on
+ *	sx_fill: NULL, or double fill values, which are taken as missing
+ *	sx_by: NULL for dates, or what to bin them by, as utCalendarBins
+ *	sx_out: name of the file to write
+ *	sx_chunk: number of values to decode at a time
+ * Return value: the number of values decoded.
+ */
+SEXP R_utCalendarStream( SEXP sx_file, SEXP sx_type, SEXP sx_endian, SEXP sx_skip, SEXP sx_unit, 
+			SEXP sx_calendar, SEXP sx_fill, SEXP sx_by, SEXP sx_out, SEXP sx_chunk )
+{
+	utUnit 		utmp, *u;
+	udu_calendar_id	cal_id;
+	udu_stream	st;
+	udu_stream_file	sf;
+	int		kind, nfill, retval;
+	double		*fill, chunk, t0 = 0.;
+
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
+
+	u      = R_ututil_unit( sx_unit, &utmp, "utCalendarStream" );
+	cal_id = R_ututil_calendar_id( sx_calendar );
+	kind   = R_ututil_stream_kind( sx_by );
+	nfill  = isNull( sx_fill ) ? 0 : length( sx_fill );
+	fill   = (nfill > 0) ? REAL( sx_fill ) : NULL;
+	if( ! ((chunk = asReal( sx_chunk )) >= 1.) )
+		error( "utCalendarStream (R version): error: chunk must be 1 or more!" );
+
+	/* Nothing below here may raise an R error until the files are closed */
+	R_ututil_stream_open( &st, sx_file, sx_type, sx_endian, sx_skip );
+	if( (sf.fp = fopen( CHAR(STRING_ELT(sx_out,0)), "wb" )) == NULL ) {
+		udu_stream_close( &st );
+		error( "utCalendarStream (R version): error: could not write %s", CHAR(STRING_ELT(sx_out,0)) );
+		}
+	sf.nvals  = st.nvals;
+	sf.binned = (kind >= 0);
+
+	retval = udu_stream_decode( &R_udu_cal_ctx, &st, u, cal_id, fill, nfill, kind, (size_t)chunk,
+			NA_INTEGER, NA_REAL, udu_stream_file_sink, &sf );
+	if( (fclose( sf.fp ) != 0) && (retval == 0) )
+		retval = UT_EIO;
+	udu_stream_close( &st );
+
+	if( retval == UT_EIO )
+		error( "utCalendarStream (R version): error reading %s or writing %s", 
+			CHAR(STRING_ELT(sx_file,0)), CHAR(STRING_ELT(sx_out,0)) );
+	R_ututil_calendar_error( retval );
+
+	UDU_STAT_STOP( UDU_STAT_R_CALENDAR_STREAM, st.nvals, t0 );
+	return( ScalarReal( (double)st.nvals ));
+}
+
+/******************************************************************/
+/* Decodes one chunk of a file of time values, for utCalendarStream
+ * to hand to a function.  The file is opened for each chunk, so 
+ * nothing is left open between calls.
+ * Inputs: as R_utCalendarStream, plus
+ *	sx_start: the (0-based) index of the first value of the chunk
+ *	sx_n: the number of values in the chunk
+ * Return value: the bin keys, if sx_by is not NULL; otherwise a list
+ *	of columns year, month, day, hour, minute, second, and status 
+ *	(as utCalendar's "status" attribute).  NULL past the end of the 
+ *	file.  Either way, attribute "nvals" is the number of values in 
+ *	the file.
+ */
+SEXP R_utCalendarStream_chunk( SEXP sx_file, SEXP sx_type, SEXP sx_endian, SEXP sx_skip, SEXP sx_unit, 
+			SEXP sx_calendar, SEXP sx_fill, SEXP sx_by, SEXP sx_start, SEXP sx_n )
+{
+	static const char *names[] = { "year", "month", "day", "hour", "minute", "second", "status" };
+	utUnit 		utmp, *u;
+	udu_calendar_id	cal_id;
+	udu_stream	st;
+	int		kind, nfill, retval, j;
+	size_t		n, nvals;
+	double		*vals, *fill, start, t0 = 0.;
+	SEXP		sx_retval, sx_names;
+
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
+
+	u      = R_ututil_unit( sx_unit, &utmp, "utCalendarStream" );
+	cal_id = R_ututil_calendar_id( sx_calendar );
+	kind   = R_ututil_stream_kind( sx_by );
+	nfill  = isNull( sx_fill ) ? 0 : length( sx_fill );
+	fill   = (nfill > 0) ? REAL( sx_fill ) : NULL;
+	start  = asReal( sx_start );
+	n      = (asReal( sx_n ) >= 1.) ? (size_t)asReal( sx_n ) : 0;
+	if( ! (start >= 0.) )
+		error( "utCalendarStream (R version): error: start must be 0 or more!" );
+	vals   = (double *)R_alloc( n + 1, sizeof(double) );
+
+	R_ututil_stream_open( &st, sx_file, sx_type, sx_endian, sx_skip );
+	nvals = st.nvals;
+	n     = udu_stream_read( &st, (size_t)start, n, fill, nfill, vals );
+	udu_stream_close( &st );
+
+	if( n == 0 ) {
+		sx_retval = R_NilValue;
+		}
+	else if( kind >= 0 ) {
+		PROTECT( sx_retval = allocVector( INTSXP, n ));
+		retval = udu_bin_keys( &R_udu_cal_ctx, vals, n, u, cal_id, (udu_bin_kind)kind, 
+				INTEGER(sx_retval), NA_INTEGER );
+		R_ututil_calendar_error( retval );
+		setAttrib( sx_retval, install("nvals"), ScalarReal( (double)nvals ));
 		UNPROTECT(1);
-		return( sx_single_retval );
 		}
+	else
+		{
+		PROTECT( sx_retval = allocVector( VECSXP, 7 ));
+		for( j=0; j<7; j++ )
+			SET_VECTOR_ELT( sx_retval, j, allocVector( (j == 5) ? REALSXP : INTSXP, n ));
+		retval = utCalendar_cal_batch_status( &R_udu_cal_ctx, vals, n, u, cal_id, NULL, 0,
+				INTEGER(VECTOR_ELT(sx_retval,0)), INTEGER(VECTOR_ELT(sx_retval,1)),
+				INTEGER(VECTOR_ELT(sx_retval,2)), INTEGER(VECTOR_ELT(sx_retval,3)),
+				INTEGER(VECTOR_ELT(sx_retval,4)), REAL(VECTOR_ELT(sx_retval,5)),
+				INTEGER(VECTOR_ELT(sx_retval,6)), NA_INTEGER, NA_REAL );
+		R_ututil_calendar_error( retval );
+
+		PROTECT( sx_names = allocVector( STRSXP, 7 ));
+		for( j=0; j<7; j++ )
+			SET_STRING_ELT( sx_names, j, mkChar( names[j] ));
+		setAttrib( sx_retval, R_NamesSymbol, sx_names );
+		setAttrib( sx_retval, install("nvals"), ScalarReal( (double)nvals ));
+		UNPROTECT(2);
+		}
+
+	UDU_STAT_STOP( UDU_STAT_R_CALENDAR_STREAM, n, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Finds the runs of a sorted time axis that fall in a set of ranges
+ * (see utTimeIndex.c).
+ * Inputs:
+ *	sx_axis: double values of the time axis, increasing
+ *	sx_lo, sx_hi: the ranges, lo <= t < hi, as double values of the 
+ *		axis's unit
+ * Return value: a matrix with columns "start" and "end", the first 
+ *	and last indices (from 1) of each run of the axis in the ranges.
+ */
+SEXP R_utTimeIndex( SEXP sx_axis, SEXP sx_lo, SEXP sx_hi )
+{
+	R_xlen_t	nranges;
+	size_t		nruns;
+	double		*start, *end, t0 = 0.;
+	int		retval;
+	size_t		k;
+	SEXP		sx_retval, sx_dimnames, sx_names;
+
+	UDU_STAT_START( t0 );
+
+	if( XLENGTH( sx_lo ) != XLENGTH( sx_hi ))
+		error( "utTimeIndex (R version): error: lo and hi are not the same length!" );
+	nranges = XLENGTH( sx_lo );
+	start   = (double *)R_alloc( nranges + 1, sizeof(double) );
+	end     = (double *)R_alloc( nranges + 1, sizeof(double) );
+
+	retval = udu_time_index( REAL(sx_axis), XLENGTH(sx_axis), REAL(sx_lo), REAL(sx_hi), nranges, start, end, &nruns );
+	if( retval != 0 )
+		error( "utTimeIndex (R version): error %d!", retval );
+
+	PROTECT( sx_retval = allocMatrix( REALSXP, nruns, 2 ));
+	for( k=0; k<nruns; k++ ) {
+		REAL(sx_retval)[k]       = start[k] + 1.;
+		REAL(sx_retval)[k+nruns] = end[k]   + 1.;
+		}
+
+	PROTECT( sx_dimnames = allocVector( VECSXP, 2 ));
+	PROTECT( sx_names    = allocVector( STRSXP, 2 ));
+	SET_STRING_ELT( sx_names, 0, mkChar("start") );
+	SET_STRING_ELT( sx_names, 1, mkChar("end"  ) );
+	SET_VECTOR_ELT( sx_dimnames, 1, sx_names );
+	setAttrib( sx_retval, R_DimNamesSymbol, sx_dimnames );
+
+	UNPROTECT(3);
+	UDU_STAT_STOP( UDU_STAT_R_TIME_INDEX, nranges, t0 );
+	return( sx_retval );
 }
 
 /******************************************************************/
 /* Note this is not the same thing as being a calendar.  A calendar
  * has BOTH a time unit and an origin.
  */
-void R_utIsTime( double *origin_factor, int *hasorigin_powers, int *retval )
+SEXP R_utIsTime( SEXP sx_unit )
 {
-	utUnit u;
+	utUnit utmp;
 
-	R_ututil_Rstyle_to_utUnit( origin_factor, hasorigin_powers, &u );
-	*retval = utIsTime( &u );
+	return( ScalarLogical( R_ututil_utIsTime( R_ututil_unit( sx_unit, &utmp, "utIsTime" )) != 0 ));
 }
 
 /******************************************************************/
-void R_utHasOrigin( double *origin_factor, int *hasorigin_powers, int *retval )
+/* Whether a unit has an origin is part of the unit, so this doesn't
+ * need the library to have loaded its units file.
+ */
+SEXP R_utHasOrigin( SEXP sx_unit )
 {
-	utUnit u;
+	utUnit utmp;
 
-	R_ututil_Rstyle_to_utUnit( origin_factor, hasorigin_powers, &u );
-	*retval = utHasOrigin( &u );
+	return( ScalarLogical( R_ututil_unit( sx_unit, &utmp, "utHasOrigin" )->hasorigin != 0 ));
 }
 
 /******************************************************************/
-/* Converts a given year, month, day, hour, minute, and second
- * into a value, given an appropriate time unit to work with.
+/* Converts given years, months, days, hours, minutes, and seconds
+ * into values, given an appropriate time unit and calendar to work with.
  * Inputs:
- *	ndates: number of dates to convert
- *	year: array of years
- *	month: array of months
- *	day: array of days
- *	hour: array of hours
- *	minute: array of minutes
- *	second: array of seconds (double precision value)
- *	origin_factor, hasorigin_powers: describe the udunit
- * Outputs:
- * 	value: what that date corresponds to, in the described units.
- *	retval: 0 if no error, not 0 if an error.
+ *	sx_date: either a list of 6 columns (year, month, day, hour, and
+ *		minute as integers, second as double) all the same length,
+ *		or a list of objects of class "utDate"
+ *	sx_is_columns: TRUE if sx_date is a list of columns
+ *	sx_unit: the time unit, a 'udUnits' object from utScan
+ *	sx_calendar: the calendar the dates are on
+ * Return value: 
+ * 	what the dates correspond to, in the described units.
  */
-void R_utInvCalendar( int *ndates, int *year, int *month, int *day, int *hour,
-	int *minute, double *second, double *origin_factor, 
-	int *hasorigin_powers, double *value, int *retval )
+SEXP R_utInvCalendar_v1p3( SEXP sx_date, SEXP sx_is_columns, SEXP sx_unit, SEXP sx_calendar )
 {
-	utUnit 	u;
-	int i;
+	utUnit 	utmp, *u;
+	int	i, ndates, retval, *year, *month, *day, *hour, *minute, *status;
+	double	*second, t0 = 0.;
+	SEXP	sx_columns, sx_elt, sx_retval;
 
-	R_ututil_Rstyle_to_utUnit( origin_factor, hasorigin_powers, &u );
+	UDU_STAT_START( t0 );
+	R_ututil_need_lib();
+	u = R_ututil_unit( sx_unit, &utmp, "utInvCalendar" );
 
-	for( i=0; i<*ndates; i++ ) {
-		if( (*retval = utInvCalendar( year[i], month[i], day[i],
-				hour[i], minute[i], second[i], &u, (value+i) )) != 0 ) {
-			if( *retval == UT_ENOINIT ) {
-				fprintf( stderr, "utInvCalendar (R version): error: udunits package not initialized yet!\n");
-				fprintf( stderr, "You must call utInit() first.\n" );
-				return;
-				}
+	sx_columns = R_NilValue;
+	if( asLogical( sx_is_columns ))
+		sx_columns = sx_date;
+	else
+		sx_columns = R_utDateList_columns( sx_date );	/* a compact list from utCalendar */
 
-			if( *retval == UT_EINVALID ) {
-				fprintf( stderr, "utInvCalendar (R version): error: units are not temporal!\n" );
-				return;
-				}
+	if( sx_columns != R_NilValue ) {
+		ndates = length( VECTOR_ELT(sx_columns,0) );
+		year   = INTEGER( VECTOR_ELT(sx_columns,0) );
+		month  = INTEGER( VECTOR_ELT(sx_columns,1) );
+		day    = INTEGER( VECTOR_ELT(sx_columns,2) );
+		hour   = INTEGER( VECTOR_ELT(sx_columns,3) );
+		minute = INTEGER( VECTOR_ELT(sx_columns,4) );
+		second = REAL   ( VECTOR_ELT(sx_columns,5) );
+		}
+	else
+		{
+		/* A list of utDate objects; gather them into columns */
+		ndates = length( sx_date );
+		year   = (int *)R_alloc( ndates, sizeof(int) );
+		month  = (int *)R_alloc( ndates, sizeof(int) );
+		day    = (int *)R_alloc( ndates, sizeof(int) );
+		hour   = (int *)R_alloc( ndates, sizeof(int) );
+		minute = (int *)R_alloc( ndates, sizeof(int) );
+		second = (double *)R_alloc( ndates, sizeof(double) );
 
-			fprintf( stderr, "utInvCalendar (R version): unknown error %d!\n",
-				*retval );
-			return;
+		for( i=0; i<ndates; i++ ) {
+			sx_elt = VECTOR_ELT( sx_date, i );
+			if( ! inherits( sx_elt, "utDate" ))
+				error( "utInvCalendar (R version): error: element %d of the date list is not of class 'utDate'!", i+1 );
+			year  [i] = asInteger( R_ututil_list_elt( sx_elt, "year"   ));
+			month [i] = asInteger( R_ututil_list_elt( sx_elt, "month"  ));
+			day   [i] = asInteger( R_ututil_list_elt( sx_elt, "day"    ));
+			hour  [i] = R_ututil_list_int ( sx_elt, "hour"   );
+			minute[i] = R_ututil_list_int ( sx_elt, "minute" );
+			second[i] = R_ututil_list_real( sx_elt, "second" );
 			}
 		}
+
+	PROTECT( sx_retval = allocVector( REALSXP, ndates ));
+
+	/* A date with any field NA gives NA */
+	status = (int *)R_alloc( ndates, sizeof(int) );
+	if( (retval = utInvCalendar_cal_batch_status( &R_udu_cal_ctx, year, month, day, hour, minute, second, 
+			ndates, u, R_ututil_calendar_id( sx_calendar ), status, NA_INTEGER, NA_REAL, 
+			REAL(sx_retval) )) != 0 ) {
+		if( retval == UT_ENOINIT ) 
+			error( "utInvCalendar (R version): error: udunits package not initialized yet!  You must call utInit() first." );
+
+		else if( retval == UT_EINVALID )
+			error( "utInvCalendar (R version): error: units are not temporal!" );
+
+		else
+			error( "utInvCalendar (R version): unknown error %d!\n", retval );
+		}
+
+	UNPROTECT(1);
+	UDU_STAT_STOP( UDU_STAT_R_INV_CALENDAR, ndates, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Raises an R error for a nonzero return code from utConvert; does
+ * nothing if retval is 0.
+ */
+static void R_ututil_convert_error( int retval, const char *caller )
+{
+	if( retval == 0 )
+		return;
+
+	if( retval == UT_ENOINIT ) 
+		error( "%s (R version): error: udunits package not initialized yet!  You must call utInit() first.", caller );
+
+	else if( retval == UT_EINVALID )
+		error( "%s (R version): error: passed an invalid unit structure!", caller );
+
+	else if( retval == UT_ECONVERT )
+		error( "%s (R version): error: units are incompatible, cannot convert between them!", caller );
+
+	else
+		error( "%s (R version): unknown error %d!", caller, retval );
+}
+
+/******************************************************************/
+/* utConvert, except that if the udunits library hasn't loaded its
+ * units file yet (because a snapshot is being used), conversions 
+ * between units without origins are done here, without loading it:
+ * they only need the units to have the same dimensions (powers), and
+ * the ratio of their factors.
+ */
+static int R_ututil_utConvert( utUnit *from, utUnit *to, double *slope, double *intercept )
+{
+	int	i;
+
+	if( (R_udu_lib_state == R_UDU_LIB_DEFERRED) && (! from->hasorigin) && (! to->hasorigin) ) {
+		for( i=0; i<UT_MAXNUM_BASE_QUANTITIES; i++ )
+			if( from->power[i] != to->power[i] )
+				return( UT_ECONVERT );
+		*slope     = from->factor / to->factor;
+		*intercept = 0.0;
+		UDU_STAT_EVENT( UDU_STAT_EV_NATIVE_CONVERT );
+		return(0);
+		}
+
+	R_ututil_need_lib();
+	return( utConvert( from, to, slope, intercept ));
 }
 
 /******************************************************************
  * Returns the coefficients for the linear transformation between
  * the "from" units and the "to" units.
  * Inputs:
- * 	from_origin_factor, from_hasorigin_powers: describe the udunit
- * 		we are converting *from*
- * 	to_origin_factor, to_hasorigin_powers: describe the udunit we
- * 		are converting *to*
- * Outputs:
- * 	slope, intercept: values for transforming the units
- * 	retval: 0 if no error, not 0 if an error
- *
+ * 	sx_from: the udunit we are converting *from*
+ * 	sx_to:   the udunit we are converting *to*
+ * Return value: c(slope,intercept), the values for transforming 
+ *	the units.  Raises an R error if the units are incompatible.
  */
-void R_utConvert( double *origin_factor_from, int *hasorigin_powers_from,
-	double *origin_factor_to, int *hasorigin_powers_to,
-	double *slope, double *intercept, int *retval )
+SEXP R_utConvert( SEXP sx_from, SEXP sx_to )
 {
-	utUnit	u_from, u_to;
+	utUnit	utmp_from, utmp_to;
+	double	t0 = 0.;
+	SEXP	sx_retval;
 
-	R_ututil_Rstyle_to_utUnit( origin_factor_from, hasorigin_powers_from, &u_from );
-	R_ututil_Rstyle_to_utUnit( origin_factor_to, hasorigin_powers_to, &u_to );
+	UDU_STAT_START( t0 );
+	PROTECT( sx_retval = allocVector( REALSXP, 2 ));
 
-	if( (*retval = utConvert( &u_from, &u_to, slope, intercept )) != 0 ) {
-		if( *retval == UT_ENOINIT ) {
-			fprintf( stderr, "utConvert (R version): error: udunits package not initialized yet!\n");
-			fprintf( stderr, "You must call utInit() first.\n" );
-			return;
-			}
+	R_ututil_convert_error( R_ututil_utConvert( R_ututil_unit( sx_from, &utmp_from, "utConvert" ), 
+						    R_ututil_unit( sx_to,   &utmp_to,   "utConvert" ), 
+						    REAL(sx_retval), REAL(sx_retval)+1 ), "utConvert" );
 
-		if( *retval == UT_EINVALID ) {
-			fprintf( stderr, "utConvert (R version): error: passed an invalid unit structure!\n" );
-			return;
-			}
+	UNPROTECT(1);
+	UDU_STAT_STOP( UDU_STAT_R_CONVERT, 1, t0 );
+	return( sx_retval );
+}
 
-		if( *retval == UT_ECONVERT ) {
-			fprintf( stderr, "utConvert (R version): error: units are incompatible, cannot convert between them!\n" );
-			return;
+/******************************************************************/
+/* Applies converter conv to the values in sx_val; see 
+ * R_utConvert_values for the arguments and return value.
+ */
+static SEXP R_ututil_convert_values( SEXP sx_val, const utConverter *conv, SEXP sx_fill, SEXP sx_inplace )
+{
+	SEXP	 sx_retval;
+	double	 *fill, t0 = 0.;
+	int	 nfill;
+	R_xlen_t n;
+
+	UDU_STAT_START( t0 );
+	n = XLENGTH( sx_val );
+
+	if( isNull( sx_fill )) {
+		fill  = NULL;
+		nfill = 0;
+		}
+	else
+		{
+		fill  = REAL( sx_fill );
+		nfill = length( sx_fill );
+		}
+
+	if( TYPEOF(sx_val) == REALSXP ) {
+		/* inplace is only a hint: a vector anything else may refer to is copied */
+		if( (asLogical( sx_inplace ) == TRUE) && (! MAYBE_SHARED( sx_val )) )
+			sx_retval = sx_val;
+		else
+			{
+			sx_retval = allocVector( REALSXP, n );
+			DUPLICATE_ATTRIB( sx_retval, sx_val );
 			}
+		PROTECT( sx_retval );
+		utConverter_apply_double( conv, REAL(sx_val), REAL(sx_retval), n, fill, nfill );
+		}
 
-		fprintf( stderr, "utConvert (R version): unknown error %d!\n", *retval );
-		return;
+	else if( (TYPEOF(sx_val) == INTSXP) || (TYPEOF(sx_val) == LGLSXP) ) {
+		PROTECT( sx_retval = allocVector( REALSXP, n ));
+		DUPLICATE_ATTRIB( sx_retval, sx_val );
+		utConverter_apply_int( conv, INTEGER(sx_val), REAL(sx_retval), n, fill, nfill, 
+			NA_INTEGER, NA_REAL );
 		}
+
+	else
+		error( "utConvertValues (R version): error: values to convert must be numeric!" );
+
+	UNPROTECT(1);
+	UDU_STAT_STOP( UDU_STAT_R_CONVERT_VALUES, n, t0 );
+	return( sx_retval );
+}
+
+/******************************************************************
+ * Converts a vector of values with the given slope and intercept
+ * (as returned by utConvert) in one pass.
+ * Inputs:
+ *	sx_val: double or integer values to convert
+ *	sx_slope, sx_intercept: the conversion
+ *	sx_fill: NULL, or a double vector of fill values, which (like
+ *		NA and NaN) are passed through unchanged
+ *	sx_inplace: if TRUE, and sx_val is a double vector that nothing
+ *		else refers to, it is overwritten with the converted values
+ *		rather than copied
+ * Return value: the converted values, with the attributes (names,
+ *	dim, etc.) of sx_val.
+ */
+SEXP R_utConvert_values( SEXP sx_val, SEXP sx_slope, SEXP sx_intercept, SEXP sx_fill, SEXP sx_inplace )
+{
+	utConverter	conv;
+
+	utConverter_set( &conv, asReal( sx_slope ), asReal( sx_intercept ));
+
+	return( R_ututil_convert_values( sx_val, &conv, sx_fill, sx_inplace ));
+}
+
+/******************************************************************/
+/* Converter objects.  On the R side the converter is the 'ptr' element
+ * (made by R_ututil_extptr_new) of a list of class 'utConverter', which
+ * also has the slope and intercept.  A converter that has been saved 
+ * and loaded again has a NULL pointer, in which case the slope and 
+ * intercept are taken from the list.
+ */
+static const utConverter *R_ututil_converter_get( SEXP sx_conv, utConverter *tmp )
+{
+	utConverter	*conv;
+
+	if( ! isNewList( sx_conv ))
+		error( "utConverter (R version): error: passed something that is not a utConverter object!" );
+
+	if( (conv = (utConverter *)R_ututil_extptr_addr( sx_conv, "utConverter" )) != NULL )
+		return( conv );
+
+	utConverter_set( tmp, R_ututil_list_real( sx_conv, "slope" ), R_ututil_list_real( sx_conv, "intercept" ));
+	return( tmp );
+}
+
+/******************************************************************/
+/* Checks that two units are compatible and works out the conversion
+ * between them, once.  Returns an external pointer to the converter.
+ */
+SEXP R_utConverter_make( SEXP sx_from, SEXP sx_to )
+{
+	utUnit		utmp_from, utmp_to;
+	utConverter	*conv;
+	double		slope, intercept;
+	SEXP		sx_ptr;
+
+	R_ututil_convert_error( R_ututil_utConvert( R_ututil_unit( sx_from, &utmp_from, "utConverter" ),
+						    R_ututil_unit( sx_to,   &utmp_to,   "utConverter" ),
+						    &slope, &intercept ), "utConverter" );
+
+	sx_ptr = R_ututil_extptr_new( sizeof(utConverter), "utConverter", (void **)&conv );
+	utConverter_set( conv, slope, intercept );
+
+	return( sx_ptr );
+}
+
+/******************************************************************/
+/* Applies a utConverter object to values.  The other arguments and
+ * the return value are the same as for R_utConvert_values.
+ */
+SEXP R_utConverter_apply( SEXP sx_conv, SEXP sx_val, SEXP sx_fill, SEXP sx_inplace )
+{
+	utConverter	tmp;
+
+	return( R_ututil_convert_values( sx_val, R_ututil_converter_get( sx_conv, &tmp ), sx_fill, sx_inplace ));
+}
+
+/******************************************************************/
+/* Composes two utConverter objects: the returned converter does
+ * sx_first, then sx_second.
+ */
+SEXP R_utConverter_compose( SEXP sx_first, SEXP sx_second )
+{
+	utConverter	tmp1, tmp2, *conv;
+	SEXP		sx_ptr;
+
+	PROTECT( sx_ptr = R_ututil_extptr_new( sizeof(utConverter), "utConverter", (void **)&conv ));
+	utConverter_compose( R_ututil_converter_get( sx_first,  &tmp1 ), 
+			     R_ututil_converter_get( sx_second, &tmp2 ), conv );
+	UNPROTECT(1);
+
+	return( sx_ptr );
 }
 
+/******************************************************************/
+/* Returns c(slope,intercept) of the converter that external pointer
+ * sx_ptr refers to.
+ */
+SEXP R_utConverter_coefs( SEXP sx_ptr )
+{
+	utConverter	*conv;
+	SEXP		sx_retval;
+
+	if( (TYPEOF(sx_ptr) != EXTPTRSXP) || ((conv = (utConverter *)R_ExternalPtrAddr( sx_ptr )) == NULL))
+		error( "utConverter (R version): error: converter pointer is not valid!" );
+
+	PROTECT( sx_retval = allocVector( REALSXP, 2 ));
+	REAL(sx_retval)[0] = conv->slope;
+	REAL(sx_retval)[1] = conv->intercept;
+	UNPROTECT(1);
+
+	return( sx_retval );
+}
+
+/******************************************************************/
+/* Returns the values of a 'utQuantity': slope*x + intercept of its
+ * original values x, worked out as they are read (see utQuantity.c).
+ * Inputs:
+ *	sx_val: the original values, double or integer
+ *	sx_coefs: c(slope, intercept) of the conversions done since
+ */
+SEXP R_utQuantity_value( SEXP sx_val, SEXP sx_coefs )
+{
+	if( (TYPEOF(sx_val) != REALSXP) && (TYPEOF(sx_val) != INTSXP) )
+		error( "utQuantity (R version): error: values must be double or integer!" );
+
+	return( R_utQuantity_view_make( sx_val, REAL(sx_coefs)[0], REAL(sx_coefs)[1] ));
+}
+
+/******************************************************************/
+/* Arithmetic on the values of two 'utQuantity' objects (or plain
+ * vectors), with the conversions of each done as it is read, so each
+ * is gone through once and nothing is made but the result.
+ * Inputs:
+ *	sx_a, sx_b: the original double values of each; they are recycled
+ *	sx_coefs_a, sx_coefs_b: c(slope, intercept) for each
+ *	sx_op: "+", "-", "*", or "/"
+ * Return value: the double result, as long as the longer of the two
+ *	(or empty if either is).
+ */
+SEXP R_utQuantity_arith( SEXP sx_a, SEXP sx_coefs_a, SEXP sx_b, SEXP sx_coefs_b, SEXP sx_op )
+{
+	utConverter	ca, cb;
+	R_xlen_t	na, nb, n;
+	int		op;
+	double		t0 = 0.;
+	SEXP		sx_retval;
+
+	UDU_STAT_START( t0 );
+
+	op = CHAR(STRING_ELT(sx_op,0))[0];
+	if( (op != '+') && (op != '-') && (op != '*') && (op != '/') )
+		error( "utQuantity (R version): Unrecognized operator >%s<.  Recognized values: + - * /",
+			CHAR(STRING_ELT(sx_op,0)) );
+
+	na = XLENGTH( sx_a );
+	nb = XLENGTH( sx_b );
+	n  = ((na == 0) || (nb == 0)) ? 0 : ((na > nb) ? na : nb);
+
+	utConverter_set( &ca, REAL(sx_coefs_a)[0], REAL(sx_coefs_a)[1] );
+	utConverter_set( &cb, REAL(sx_coefs_b)[0], REAL(sx_coefs_b)[1] );
+
+	PROTECT( sx_retval = allocVector( REALSXP, n ));
+	utConverter_apply2_double( &ca, REAL(sx_a), na, &cb, REAL(sx_b), nb, op, REAL(sx_retval), n );
+	UNPROTECT(1);
+
+	UDU_STAT_STOP( UDU_STAT_R_QUANTITY, n, t0 );
+	return( sx_retval );
+}
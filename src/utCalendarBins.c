@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include "udunits.h"
+#include "utCalendar_cal.h"
+#include "utCalendarBins.h"
+
+/*-----------------------------------------------------------------------------
+ * Groups dates into calendar bins (years, months, seasons, days of the year,
+ * ...) and reduces data over the bins, for climatologies and the like.  The
+ * values are decoded a block at a time, so the dates never exist all at once;
+ * a block is big enough for the calendar kernels to split across threads.
+ *----------------------------------------------------------------------------*/
+
+#define UDU_BIN_BLOCK	16384
+
+/******************************************************************************/
+udu_bin_kind udu_bin_kind_id( const char *name )
+{
+	static const char *names[] = { "year", "month", "yearmonth", "season", "yearseason", "doy",
+					"pentad", "dow" };
+	int	i;
+
+	for( i=0; i<(int)UDU_BIN_UNKNOWN; i++ )
+		if( strcmp( name, names[i] ) == 0 )
+			return( (udu_bin_kind)i );
+
+	return( UDU_BIN_UNKNOWN );
+}
+
+/******************************************************************************/
+udu_reduce_op udu_reduce_op_id( const char *name )
+{
+	static const char *names[] = { "mean", "sum", "min", "max" };
+	int	i;
+
+	for( i=0; i<(int)UDU_REDUCE_UNKNOWN; i++ )
+		if( strcmp( name, names[i] ) == 0 )
+			return( (udu_reduce_op)i );
+
+	return( UDU_REDUCE_UNKNOWN );
+}
+
+/******************************************************************************/
+/* 5-day period of the year.  In leap years 29 February is put in the same
+ * pentad as 28 February, so every year has 73 (72 on the 360_day calendar).
+ */
+static int udu_pentad( udu_calendar_id calendar, int year, int month, int day, int doy )
+{
+	if( calendar != UDU_CAL_360_DAY ) {
+		if( (month == 2) && (day == 29) )
+			doy = 59;
+		else if( (month > 2) && udu_date_is_valid( calendar, year, 2, 29 ))
+			doy--;
+		}
+
+	return( (doy > 365) ? 73 : (doy-1)/5 + 1 );
+}
+
+/******************************************************************************/
+/* The key is worked out in 64 bits, since year*100 needs more than an int
+ * for years tens of millions from now, which a value can still decode to.
+ */
+static int64_t udu_bin_key( udu_calendar_id calendar, udu_bin_kind kind, int year, int month, int day )
+{
+	int	season;
+	int64_t	syear;
+
+	season = (month % 12)/3 + 1;
+
+	switch( kind ) {
+		case UDU_BIN_YEAR:
+			return( year );
+
+		case UDU_BIN_MONTH:
+			return( month );
+
+		case UDU_BIN_YEARMONTH:
+			return( (int64_t)year*100 + month );
+
+		case UDU_BIN_SEASON:
+			return( season );
+
+		case UDU_BIN_YEARSEASON:
+			syear = (month == 12) ? (int64_t)year+1 : year;
+			if( (syear == 0) && ((calendar == UDU_CAL_STANDARD) || (calendar == UDU_CAL_UNKNOWN)) )
+				syear = 1;	/* no year 0 on the standard calendar */
+			return( syear*10 + season );
+
+		case UDU_BIN_DOY:
+			return( udu_day_of_year( calendar, year, month, day ));
+
+		case UDU_BIN_PENTAD:
+			return( udu_pentad( calendar, year, month, day, udu_day_of_year( calendar, year, month, day )));
+
+		default:	/* day of the week */
+			return( (udu_day_of_week( calendar, year, month, day ) + 6) % 7 + 1 );
+		}
+}
+
+/******************************************************************************/
+int udu_bin_keys( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits,
+			udu_calendar_id calendar, udu_bin_kind kind, int *key, int na_key )
+{
+	size_t	i0, k, nblock;
+	int	*year, *month, *day, *hour, *minute, *status, err;
+	int64_t	bkey;
+	double	*second;
+	void	*buf;
+
+	nblock = (n < UDU_BIN_BLOCK) ? n : UDU_BIN_BLOCK;
+	if( nblock == 0 )
+		return(0);
+
+	if( (buf = malloc( nblock*(6*sizeof(int) + sizeof(double)) )) == NULL )
+		return( UT_EALLOC );
+	second = (double *)buf;
+	year   = (int *)(second + nblock);
+	month  = year   + nblock;
+	day    = month  + nblock;
+	hour   = day    + nblock;
+	minute = hour   + nblock;
+	status = minute + nblock;
+
+	err = 0;
+	for( i0=0; i0<n; i0 += nblock ) {
+		if( nblock > n - i0 )
+			nblock = n - i0;
+
+		/* Missing values, and those too far from the reference date, get na_key */
+		if( (err = utCalendar_cal_batch_status( ctx, vals+i0, nblock, dataunits, calendar, NULL, 0, 
+				year, month, day, hour, minute, second, status, 0, 0. )) != 0 )
+			break;
+
+		/* A key that doesn't fit in an int, or would read as na_key, gets na_key */
+		for( k=0; k<nblock; k++ ) {
+			key[i0+k] = na_key;
+			if( status[k] != UDU_VALUE_OK )
+				continue;
+			bkey = udu_bin_key( calendar, kind, year[k], month[k], day[k] );
+			if( (bkey > INT_MIN) && (bkey <= INT_MAX) && (bkey != na_key) )
+				key[i0+k] = (int)bkey;
+			}
+		}
+
+	free( buf );
+	return( err );
+}
+
+/******************************************************************************/
+size_t udu_bin_range( const int *key, size_t n, int na_key, int *keymin, int *keymax )
+{
+	size_t	i, nkeys;
+
+	nkeys = 0;
+	for( i=0; i<n; i++ ) {
+		if( key[i] == na_key )
+			continue;
+		if( (nkeys == 0) || (key[i] < *keymin) )
+			*keymin = key[i];
+		if( (nkeys == 0) || (key[i] > *keymax) )
+			*keymax = key[i];
+		nkeys++;
+		}
+
+	return( nkeys );
+}
+
+/******************************************************************************/
+void udu_bin_reduce( const int *key, size_t n, int na_key, const double *data, size_t m, udu_reduce_op op,
+			int keymin, size_t nbins, double *result, double *count, double *nsteps, double na_out )
+{
+	size_t		t, j, b, nc;
+	double		init, x, *acc, *cnt;
+	const double	*row;
+
+	nc   = m*nbins;
+	init = (op == UDU_REDUCE_MIN) ? HUGE_VAL : ((op == UDU_REDUCE_MAX) ? -HUGE_VAL : 0.);
+	for( j=0; j<nc; j++ ) {
+		result[j] = init;
+		count[j]  = 0.;
+		}
+	memset( nsteps, 0, nbins*sizeof(double) );
+
+	for( t=0; t<n; t++ ) {
+		if( key[t] == na_key )
+			continue;
+		b   = (size_t)(key[t] - keymin);
+		row = data + t*m;
+		acc = result + b*m;
+		cnt = count  + b*m;
+		nsteps[b] += 1.;
+
+		switch( op ) {
+			case UDU_REDUCE_MIN:
+				for( j=0; j<m; j++ ) {
+					x = row[j];
+					if( ! isnan(x) ) {
+						if( x < acc[j] )
+							acc[j] = x;
+						cnt[j] += 1.;
+						}
+					}
+				break;
+
+			case UDU_REDUCE_MAX:
+				for( j=0; j<m; j++ ) {
+					x = row[j];
+					if( ! isnan(x) ) {
+						if( x > acc[j] )
+							acc[j] = x;
+						cnt[j] += 1.;
+						}
+					}
+				break;
+
+			default:	/* sum, mean */
+				for( j=0; j<m; j++ ) {
+					x = row[j];
+					if( ! isnan(x) ) {
+						acc[j] += x;
+						cnt[j] += 1.;
+						}
+					}
+				break;
+			}
+		}
+
+	for( j=0; j<nc; j++ ) {
+		if( count[j] == 0. )
+			result[j] = (op == UDU_REDUCE_SUM) ? 0. : na_out;
+		else if( op == UDU_REDUCE_MEAN )
+			result[j] /= count[j];
+		}
+}
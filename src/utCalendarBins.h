@@ -0,0 +1,45 @@
+/* What udu_bin_keys groups dates by */
+typedef enum {
+	UDU_BIN_YEAR = 0,
+	UDU_BIN_MONTH,		/* 1-12 */
+	UDU_BIN_YEARMONTH,	/* year*100 + month */
+	UDU_BIN_SEASON,		/* 1 DJF, 2 MAM, 3 JJA, 4 SON */
+	UDU_BIN_YEARSEASON,	/* year*10 + season, with December counted in the next year's DJF */
+	UDU_BIN_DOY,		/* day of the year, 1 January is 1 */
+	UDU_BIN_PENTAD,		/* 5-day period of the year, 1-73 (1-72 on the 360_day calendar) */
+	UDU_BIN_DOW,		/* day of the week, 1 Monday ... 7 Sunday, as utDayOfWeek */
+	UDU_BIN_UNKNOWN
+} udu_bin_kind;
+
+/* How udu_bin_reduce combines the values in a bin */
+typedef enum {
+	UDU_REDUCE_MEAN = 0,
+	UDU_REDUCE_SUM,
+	UDU_REDUCE_MIN,
+	UDU_REDUCE_MAX,
+	UDU_REDUCE_UNKNOWN
+} udu_reduce_op;
+
+udu_bin_kind  udu_bin_kind_id( const char *name );
+udu_reduce_op udu_reduce_op_id( const char *name );
+
+/* Decodes the n values into dates and writes the bin key of each into key;
+ * values that are not finite or out of range, and those whose key would not
+ * fit in an int (or would equal na_key), get na_key.  Returns 0 on success,
+ * a udunits error code otherwise.
+ */
+int udu_bin_keys( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits,
+			udu_calendar_id calendar, udu_bin_kind kind, int *key, int na_key );
+
+/* Smallest and largest of the n keys other than na_key; returns how many there are */
+size_t udu_bin_range( const int *key, size_t n, int na_key, int *keymin, int *keymax );
+
+/* Reduces data, which holds m values for each of the n time steps (time varying
+ * slowest), into nbins bins, bin b holding the time steps with key keymin+b,
+ * in one pass over data.  result and count must have room for m*nbins values,
+ * and nsteps for nbins: result gets the reduced values, count the number of
+ * non-NaN values that went into each, and nsteps the number of time steps in
+ * each bin.  Cells with no values get na_out.
+ */
+void udu_bin_reduce( const int *key, size_t n, int na_key, const double *data, size_t m, udu_reduce_op op,
+			int keymin, size_t nbins, double *result, double *count, double *nsteps, double na_out );
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "udunits.h"
+#include "utCalendar_cal.h"
+#include "utCalendarRemap.h"
+
+/*-----------------------------------------------------------------------------
+ * Maps time values from one unit and calendar to another, e.g. model output
+ * on the 360_day calendar onto the standard calendar of a set of observations.
+ * Values are decoded on the old calendar a block at a time, the dates fixed
+ * up where they don't exist on the new one, and the block encoded again on
+ * the new calendar.
+ *----------------------------------------------------------------------------*/
+
+#define UDU_REMAP_BLOCK	16384
+
+/* Where the months of one year start on one calendar.  Time axes are nearly
+ * always in order, so these are kept for the last year seen.
+ */
+typedef struct {
+	udu_calendar_id	calendar;
+	long		year;
+	int		first[13];	/* day of the year of the 1st of each month; first[12] is the length of the year + 1 */
+} udu_year_months;
+
+/******************************************************************************/
+udu_remap_policy udu_remap_policy_id( const char *name )
+{
+	static const char *names[] = { "drop", "clamp", "proportional" };
+	int	i;
+
+	for( i=0; i<(int)UDU_REMAP_UNKNOWN; i++ )
+		if( strcmp( name, names[i] ) == 0 )
+			return( (udu_remap_policy)i );
+
+	return( UDU_REMAP_UNKNOWN );
+}
+
+/******************************************************************************/
+static void udu_year_months_set( udu_year_months *ym, long year )
+{
+	int	m;
+
+	if( ym->year == year )
+		return;
+
+	for( m=1; m<=13; m++ )		/* month 13 is 1 January of the next year */
+		ym->first[m-1] = udu_day_of_year( ym->calendar, year, m, 1 );
+	ym->year = year;
+}
+
+/******************************************************************************/
+/* Month and day of a day of the year */
+static void udu_year_months_date( const udu_year_months *ym, int doy, int *month, int *day )
+{
+	int	m;
+
+	for( m=1; (m < 12) && (doy >= ym->first[m]); m++ )
+		;
+	*month = m;
+	*day   = doy - ym->first[m-1] + 1;
+
+	/* The standard calendar's October 1582 skips from the 4th to the 15th */
+	if( ((ym->calendar == UDU_CAL_STANDARD) || (ym->calendar == UDU_CAL_UNKNOWN)) &&
+			(ym->year == 1582) && (m == 10) && (*day > 4) )
+		*day += 10;
+}
+
+/******************************************************************************/
+/* Fixes up one date for the new calendar; returns 0 if it can't be done */
+static int udu_remap_date( udu_remap_policy policy, udu_year_months *ym_from, udu_year_months *ym_to,
+			int year, int *month, int *day )
+{
+	udu_calendar_id	to_cal = ym_to->calendar;
+	int		doy, nfrom, nto;
+
+	if( policy == UDU_REMAP_PROPORTIONAL ) {
+		if( ! udu_date_is_valid( to_cal, year, 1, 1 ))	/* e.g. year 0 on the standard calendar */
+			return(0);
+		udu_year_months_set( ym_from, year );
+		udu_year_months_set( ym_to,   year );
+		nfrom = ym_from->first[12] - 1;
+		nto   = ym_to->first[12]   - 1;
+		doy   = udu_day_of_year( ym_from->calendar, year, *month, *day );
+		doy   = (int)(((long)(doy - 1) * nto) / nfrom) + 1;
+		udu_year_months_date( ym_to, doy, month, day );
+		return(1);
+		}
+
+	if( udu_date_is_valid( to_cal, year, *month, *day ))
+		return(1);
+	if( policy == UDU_REMAP_DROP )
+		return(0);
+
+	/* Clamp: past the end of the month goes to its last day, and the days
+	 * skipped in October 1582 go to the first day after them.
+	 */
+	if( (*month == 10) && (*day > 4) && (*day < 15) && udu_date_is_valid( to_cal, year, 10, 15 ))
+		*day = 15;
+	while( (*day > 28) && (! udu_date_is_valid( to_cal, year, *month, *day )) )
+		(*day)--;
+
+	return( udu_date_is_valid( to_cal, year, *month, *day ));
+}
+
+/******************************************************************************/
+int udu_calendar_remap( const udu_cal_context *ctx, const double *vals, size_t n,
+			utUnit *from_unit, udu_calendar_id from_cal, utUnit *to_unit, udu_calendar_id to_cal,
+			udu_remap_policy policy, double *out, int *valid, double na_out )
+{
+	udu_year_months	ym_from, ym_to;
+	size_t		i0, k, nblock;
+	int		*year, *month, *day, *hour, *minute, *status, err;
+	double		*second;
+	void		*buf;
+
+	nblock = (n < UDU_REMAP_BLOCK) ? n : UDU_REMAP_BLOCK;
+	if( nblock == 0 )
+		return(0);
+
+	if( (buf = malloc( nblock*(6*sizeof(int) + sizeof(double)) )) == NULL )
+		return( UT_EALLOC );
+	second = (double *)buf;
+	year   = (int *)(second + nblock);
+	month  = year   + nblock;
+	day    = month  + nblock;
+	hour   = day    + nblock;
+	minute = hour   + nblock;
+	status = minute + nblock;
+
+	ym_from.calendar = from_cal;
+	ym_to.calendar   = to_cal;
+	ym_from.year     = ym_to.year = -1000000000L;	/* none yet */
+
+	err = 0;
+	for( i0=0; i0<n; i0 += nblock ) {
+		if( nblock > n - i0 )
+			nblock = n - i0;
+
+		/* Missing values, and those too far from the reference date, are dropped */
+		if( (err = utCalendar_cal_batch_status( ctx, vals+i0, nblock, from_unit, from_cal, NULL, 0,
+				year, month, day, hour, minute, second, status, 0, 0. )) != 0 )
+			break;
+
+		/* Dates that can't be mapped are encoded as a harmless date, then set to na_out */
+		for( k=0; k<nblock; k++ ) {
+			valid[i0+k] = (status[k] == UDU_VALUE_OK) &&
+				udu_remap_date( policy, &ym_from, &ym_to, year[k], month+k, day+k );
+			if( ! valid[i0+k] ) {
+				year[k]  = 2001;
+				month[k] = 1;
+				day[k]   = 1;
+				}
+			}
+
+		if( (err = utInvCalendar_cal_batch( ctx, year, month, day, hour, minute, second, nblock,
+				to_unit, to_cal, out+i0 )) != 0 )
+			break;
+
+		for( k=0; k<nblock; k++ )
+			if( ! valid[i0+k] )
+				out[i0+k] = na_out;
+		}
+
+	free( buf );
+	return( err );
+}
@@ -0,0 +1,20 @@
+/* What udu_calendar_remap does with a date that is not on the new calendar */
+typedef enum {
+	UDU_REMAP_DROP = 0,		/* the value becomes invalid */
+	UDU_REMAP_CLAMP,		/* moved to the last day of its month, e.g. 30 Feb -> 28 or 29 Feb */
+	UDU_REMAP_PROPORTIONAL,		/* every date is moved to the same fraction of its year */
+	UDU_REMAP_UNKNOWN
+} udu_remap_policy;
+
+udu_remap_policy udu_remap_policy_id( const char *name );
+
+/* Maps the n values of from_unit on calendar from_cal to values of to_unit on
+ * calendar to_cal that have the same date and time of day (or, with
+ * UDU_REMAP_PROPORTIONAL, the same position in the year).  valid[i] is set to
+ * 1 if out[i] was found and 0 if not, when out[i] is set to na_out; values
+ * that are not finite are never valid.  Returns 0 on success, a udunits
+ * error code otherwise.
+ */
+int udu_calendar_remap( const udu_cal_context *ctx, const double *vals, size_t n,
+			utUnit *from_unit, udu_calendar_id from_cal, utUnit *to_unit, udu_calendar_id to_cal,
+			udu_remap_policy policy, double *out, int *valid, double na_out );
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <math.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "udunits.h"
+#include "utCalendar_cal.h"
+#include "utCalendarBins.h"
+#include "utCalendarStream.h"
+
+/*-----------------------------------------------------------------------------
+ * Decodes time values straight from a binary file, such as a time axis
+ * extracted from a netCDF file, a chunk at a time, so that the file never
+ * has to be read into memory.  The file is mapped into memory where that
+ * can be done (and each chunk's pages let go once it is done, so they don't
+ * pile up), and read with stdio otherwise.  Each chunk is converted to
+ * doubles in one buffer and decoded into a fixed set of column buffers,
+ * which are reused for every chunk.
+ *----------------------------------------------------------------------------*/
+
+#ifdef _WIN32
+#define udu_fseek	_fseeki64
+#else
+#define udu_fseek	fseeko
+#endif
+
+/******************************************************************************/
+udu_stream_type udu_stream_type_id( const char *name )
+{
+	static const char *names[] = { "float64", "int32", "int64" };
+	int	i;
+
+	for( i=0; i<(int)UDU_STREAM_UNKNOWN; i++ )
+		if( strcmp( name, names[i] ) == 0 )
+			return( (udu_stream_type)i );
+
+	return( UDU_STREAM_UNKNOWN );
+}
+
+/******************************************************************************/
+int udu_stream_open( udu_stream *st, const char *path, udu_stream_type type, int big_endian, size_t skip )
+{
+	const uint16_t	one = 1;
+	size_t		size;
+
+	st->type   = type;
+	st->width  = (type == UDU_STREAM_INT32) ? 4 : 8;
+	st->swap   = (big_endian != 0) == (*(const unsigned char *)&one == 1);
+	st->offset = skip;
+
+#ifdef _WIN32
+	if( (st->fp = fopen( path, "rb" )) == NULL )
+		return( errno );
+	udu_fseek( st->fp, 0, SEEK_END );
+	size = (size_t)_ftelli64( st->fp );
+#else
+	{
+	struct stat	sb;
+
+	if( (st->fd = open( path, O_RDONLY )) < 0 )
+		return( errno );
+	if( fstat( st->fd, &sb ) != 0 ) {
+		close( st->fd );
+		return( errno );
+		}
+	size     = (size_t)sb.st_size;
+	st->size = size;
+	st->map  = NULL;
+	if( size > 0 ) {
+		st->map = (const unsigned char *)mmap( NULL, size, PROT_READ, MAP_SHARED, st->fd, 0 );
+		if( st->map == (const unsigned char *)MAP_FAILED ) {
+			close( st->fd );
+			return( errno );
+			}
+#ifdef MADV_SEQUENTIAL
+		madvise( (void *)st->map, size, MADV_SEQUENTIAL );
+#endif
+		}
+	}
+#endif
+
+	st->nvals = (size > skip) ? (size - skip) / st->width : 0;
+	return(0);
+}
+
+/******************************************************************************/
+void udu_stream_close( udu_stream *st )
+{
+#ifdef _WIN32
+	if( st->fp != NULL )
+		fclose( st->fp );
+	st->fp = NULL;
+#else
+	if( st->map != NULL )
+		munmap( (void *)st->map, st->size );
+	if( st->fd >= 0 )
+		close( st->fd );
+	st->map = NULL;
+	st->fd  = -1;
+#endif
+}
+
+/******************************************************************************/
+/* One value of the file's type from the bytes at p */
+static double udu_stream_value( const udu_stream *st, const unsigned char *p )
+{
+	unsigned char	b[8];
+	size_t		k;
+	double		d;
+	int32_t		i4;
+	int64_t		i8;
+
+	if( st->swap ) {
+		for( k=0; k<st->width; k++ )
+			b[k] = p[st->width-1-k];
+		p = b;
+		}
+
+	switch( st->type ) {
+		case UDU_STREAM_INT32:
+			memcpy( &i4, p, 4 );
+			return( (double)i4 );
+
+		case UDU_STREAM_INT64:
+			memcpy( &i8, p, 8 );
+			return( (double)i8 );
+
+		default:
+			memcpy( &d, p, 8 );
+			return( d );
+		}
+}
+
+/******************************************************************************/
+size_t udu_stream_read( udu_stream *st, size_t i0, size_t n, const double *fill, int nfill, double *vals )
+{
+	const unsigned char	*p;
+	size_t			i;
+	int			j;
+
+	if( i0 >= st->nvals )
+		return(0);
+	if( n > st->nvals - i0 )
+		n = st->nvals - i0;
+
+#ifdef _WIN32
+	/* Read the raw bytes into the back of vals, then convert them forward in place */
+	p = (const unsigned char *)vals + n*(8 - st->width);
+	udu_fseek( st->fp, (__int64)(st->offset + i0*st->width), SEEK_SET );
+	if( fread( (void *)p, st->width, n, st->fp ) != n )
+		return(0);
+#else
+	p = st->map + st->offset + i0*st->width;
+#endif
+
+	for( i=0; i<n; i++ )
+		vals[i] = udu_stream_value( st, p + i*st->width );
+
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+	/* These pages won't be needed again; let them go, so that memory use stays flat */
+	{
+	size_t	pagesize, start, end;
+
+	pagesize = (size_t)sysconf( _SC_PAGESIZE );
+	start    = ((st->offset + i0*st->width) / pagesize) * pagesize;
+	end      = ((st->offset + (i0+n)*st->width) / pagesize) * pagesize;
+	if( end > start )
+		madvise( (void *)(st->map + start), end - start, MADV_DONTNEED );
+	}
+#endif
+
+	for( j=0; j<nfill; j++ )
+		for( i=0; i<n; i++ )
+			if( vals[i] == fill[j] )
+				vals[i] = NAN;
+
+	return( n );
+}
+
+/******************************************************************************/
+int udu_stream_decode( const udu_cal_context *ctx, udu_stream *st, utUnit *dataunits, udu_calendar_id calendar,
+			const double *fill, int nfill, int kind, size_t chunk, int na_int, double na_real,
+			udu_stream_sink sink, void *sink_data )
+{
+	udu_stream_chunk	c;
+	size_t			i0;
+	double			*vals;
+	void			*buf;
+	int			err;
+
+	if( chunk > st->nvals )
+		chunk = st->nvals;
+	if( chunk == 0 )
+		return(0);
+
+	if( (buf = malloc( chunk*(7*sizeof(int) + 2*sizeof(double)) )) == NULL )
+		return( UT_EALLOC );
+	vals     = (double *)buf;
+	c.second = vals + chunk;
+	c.year   = (int *)(c.second + chunk);
+	c.month  = c.year   + chunk;
+	c.day    = c.month  + chunk;
+	c.hour   = c.day    + chunk;
+	c.minute = c.hour   + chunk;
+	c.status = c.minute + chunk;
+	c.key    = c.status + chunk;
+
+	err = 0;
+	for( i0=0; i0<st->nvals; i0 += c.n ) {
+		c.i0 = i0;
+		if( (c.n = udu_stream_read( st, i0, chunk, fill, nfill, vals )) == 0 ) {
+			err = UT_EIO;
+			break;
+			}
+
+		if( kind >= 0 )
+			err = udu_bin_keys( ctx, vals, c.n, dataunits, calendar, (udu_bin_kind)kind, c.key, na_int );
+		else
+			err = utCalendar_cal_batch_status( ctx, vals, c.n, dataunits, calendar, NULL, 0, c.year, c.month,
+					c.day, c.hour, c.minute, c.second, c.status, na_int, na_real );
+		if( (err != 0) || ((err = sink( sink_data, &c )) != 0) )
+			break;
+		}
+
+	free( buf );
+	return( err );
+}
+
+/******************************************************************************/
+/* Writes n items of size bytes at element i0 of column col of a file sink */
+static int udu_stream_file_put( udu_stream_file *sf, int col, size_t size, size_t i0, size_t n, const void *p )
+{
+	size_t	pos;
+
+	pos = (size_t)col * sf->nvals * sizeof(int) + i0*size;
+	if( udu_fseek( sf->fp, pos, SEEK_SET ) != 0 )
+		return( UT_EIO );
+	return( (fwrite( p, size, n, sf->fp ) == n) ? 0 : UT_EIO );
+}
+
+/******************************************************************************/
+int udu_stream_file_sink( void *data, const udu_stream_chunk *c )
+{
+	udu_stream_file	*sf = (udu_stream_file *)data;
+	int		err = 0;
+
+	if( sf->binned )
+		return( udu_stream_file_put( sf, 0, sizeof(int), c->i0, c->n, c->key ));
+
+	if( ((err = udu_stream_file_put( sf, 0, sizeof(int), c->i0, c->n, c->year   )) != 0) ||
+	    ((err = udu_stream_file_put( sf, 1, sizeof(int), c->i0, c->n, c->month  )) != 0) ||
+	    ((err = udu_stream_file_put( sf, 2, sizeof(int), c->i0, c->n, c->day    )) != 0) ||
+	    ((err = udu_stream_file_put( sf, 3, sizeof(int), c->i0, c->n, c->hour   )) != 0) ||
+	    ((err = udu_stream_file_put( sf, 4, sizeof(int), c->i0, c->n, c->minute )) != 0) ||
+	    ((err = udu_stream_file_put( sf, 5, sizeof(int), c->i0, c->n, c->status )) != 0) )
+		return( err );
+
+	return( udu_stream_file_put( sf, 6, sizeof(double), c->i0, c->n, c->second ));
+}
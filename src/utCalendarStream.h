@@ -0,0 +1,72 @@
+/* Types of the values in a file of time values */
+typedef enum {
+	UDU_STREAM_FLOAT64 = 0,
+	UDU_STREAM_INT32,
+	UDU_STREAM_INT64,
+	UDU_STREAM_UNKNOWN
+} udu_stream_type;
+
+/* An open file of time values */
+typedef struct {
+	udu_stream_type	type;
+	int		swap;		/* nonzero if the values' byte order is not this machine's */
+	size_t		width;		/* bytes per value */
+	size_t		offset;		/* bytes before the first value */
+	size_t		nvals;
+#ifdef _WIN32
+	FILE		*fp;
+#else
+	int		fd;
+	const unsigned char *map;	/* the whole file */
+	size_t		size;
+#endif
+} udu_stream;
+
+udu_stream_type udu_stream_type_id( const char *name );
+
+/* Opens the file at path, holding values of the given type in big- or
+ * little-endian order after 'skip' bytes of header.  Returns 0 on success,
+ * or an errno value.
+ */
+int udu_stream_open( udu_stream *st, const char *path, udu_stream_type type, int big_endian, size_t skip );
+void udu_stream_close( udu_stream *st );
+
+/* Reads values i0 to i0+n-1 (or to the end) as doubles into vals, with
+ * values equal to one of the nfill fill values set to NaN.  Returns the
+ * number read.
+ */
+size_t udu_stream_read( udu_stream *st, size_t i0, size_t n, const double *fill, int nfill, double *vals );
+
+/* One chunk of decoded values, as passed to a udu_stream_sink.  For a binned
+ * decode only 'key' is set, otherwise only the date columns and 'status'.
+ */
+typedef struct {
+	size_t	i0, n;		/* the chunk is values i0 to i0+n-1 */
+	int	*year, *month, *day, *hour, *minute, *status, *key;
+	double	*second;
+} udu_stream_chunk;
+
+/* Called with each chunk in turn; returns nonzero to stop */
+typedef int (*udu_stream_sink)( void *data, const udu_stream_chunk *chunk );
+
+/* Decodes the whole file, chunk values at a time, into dates (kind < 0) or the
+ * bin keys of udu_bin_keys (kind a udu_bin_kind), passing each chunk to sink.
+ * Missing values get na_int, na_real, and na_key, as in utCalendar_cal_batch_status
+ * and udu_bin_keys.  Memory use depends only on chunk.  Returns 0 on success,
+ * a udunits error code, or the sink's nonzero return.
+ */
+int udu_stream_decode( const udu_cal_context *ctx, udu_stream *st, utUnit *dataunits, udu_calendar_id calendar,
+			const double *fill, int nfill, int kind, size_t chunk, int na_int, double na_real,
+			udu_stream_sink sink, void *sink_data );
+
+/* A sink that writes to a file in columns: n 32-bit ints each of year, month,
+ * day, hour, minute, and status, then n doubles of seconds; or, for a binned
+ * decode, n 32-bit ints of keys.  All in this machine's byte order.
+ */
+typedef struct {
+	FILE	*fp;
+	size_t	nvals;
+	int	binned;
+} udu_stream_file;
+
+int udu_stream_file_sink( void *data, const udu_stream_chunk *chunk );
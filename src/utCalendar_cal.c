@@ -1,22 +1,66 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <math.h>
 #include <strings.h>
 #include "udunits.h"
 #include "utCalendar_cal.h"
+#include "utStats.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /* define DEBUG */
 
-/*                                         J   F   M   A   M   J   J   A   S   O   N   D    */
-static long days_per_month_reg_year[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-static utUnit udu_origin_zero;
-static double udu_sec_since_ref_date( double val, utUnit *dataunits, int *yr0, int *mon0, 
-		int *day0, int *hr0, int *min0, float *sec0 );
-static int utCalendar_noleap_inner( double val, utUnit *dataunits, int *year, int *month, int *day, int *hour, 
-				int *minute, float *second, int days_per_year, long *days_per_month );
-static int utCalendar_360( double val, utUnit *dataunits, int *year, int *month, int *day, int *hour, 
-				int *minute, float *second );
-static int utCalendar_noleap( double val, utUnit *dataunits, int *year, int *month, int *day, int *hour, 
-				int *minute, float *second );
+/* Vectors shorter than this are always done on one thread */
+#define UDU_PAR_MIN	10000
+
+/* Regularly spaced vectors at least this long are decoded by stepping from one
+ * date to the next (see utCalendar_step_batch), in blocks of UDU_STEP_BLOCK
+ * values, each of which starts with a full decode.
+ */
+#define UDU_STEP_MIN	256
+#define UDU_STEP_BLOCK	4096
+
+/* Julian Day Number of 1970-01-01, the Unix epoch */
+#define UDU_JDN_UNIX_EPOCH	2440588L
+
+/* Julian Day Number of 1582-10-15, the first day of the standard calendar's Gregorian part */
+#define UDU_JDN_GREGORIAN	2299161L
+
+/* Values more than this many seconds from their reference date (about 30 million
+ * years) are out of range: their years would not fit in an int.  Their day numbers
+ * (about 1.2e10) don't fit in 32 bits, hence udu_daynum.
+ */
+#define UDU_MAX_SECONDS		1e15
+
+/* Cumulative days before the start of each month; the last entry is the length of the year */
+/*                                                 J   F   M   A    M    J    J    A    S    O    N    D    */
+static const long days_before_month_reg_year[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 };
+static const long days_before_month_360[]      = { 0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330, 360 };
+
+/* The reference date of a time unit, decoded once and reused for every value in that unit */
+typedef struct {
+	int	yr0, mon0, day0, hr0, min0;
+	double	sec_of_day;	/* seconds after midnight of the reference date */
+	double	factor;		/* seconds per unit of the values being converted */
+	udu_daynum day_number;	/* reference date as an absolute day number in the target calendar */
+} udu_epoch;
+
+/* All the per-calendar vector kernels have this form */
+typedef int (*udu_batch_kernel)( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				int *year, int *month, int *day, int *hour, int *minute, double *second );
+
+static udu_daynum udu_daynum_from_date( udu_calendar_id calendar, udu_daynum year, int month, int day );
+static int utCalendar_step_batch( const udu_cal_context *ctx, const double *vals, size_t n, const udu_epoch *ep,
+				udu_calendar_id calendar, int *year, int *month, int *day, int *hour, int *minute, 
+				double *second );
+static int udu_axis_is_regular( const double *vals, size_t n, const udu_epoch *ep );
+static void udu_date_from_daynum( udu_calendar_id calendar, udu_daynum daynum, int *year, int *month, int *day );
+#ifndef UDU_STD_NATIVE
+static int utCalendar_std_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				int *year, int *month, int *day, int *hour, int *minute, double *second );
+#endif
 
 /******************************************************************************/
 /* This extends the standard utCalendar call by recognizing CF-1.0 compliant
@@ -39,84 +83,302 @@ static int utCalendar_noleap( double val, utUnit *dataunits, int *year, int *mon
  * days since 1601-01-01	noleap		146000		 2001-01-01	"noleap" calendar doesn't change behavior around 1582
  * days since 2001-01-01	noleap		-146000		 1601-01-01	works with neg values too
  * days since 1001-01-01	noleap		-146000		 0601-01-01	neg values don't care before/after 1582 either
+ *
+ * days since 1001-01-01	proleptic_gregorian 146000	 1400-09-26	Gregorian leap rules all the way back
+ * days since 1582-10-15	proleptic_gregorian -1		 1582-10-14	no gap at the 1582 switch
+ * days since 1601-01-01	julian		146000		 2000-09-23	Julian leap rules all the way forward
+ * days since 1900-01-01	julian		36524		 1999-12-31	1900 is a leap year in the Julian calendar
  */
 int utCalendar_cal( double val, utUnit *dataunits, int *year, int *month, int *day, int *hour, 
 				int *minute, float *second, char *calendar ) 
 {
-	int err;
-	static int have_shown_warning = 0;
-	static int have_initted = 0;
+	udu_cal_context	ctx;
+	udu_calendar_id	cal_id;
+	int		err;
+	double		dsec;
 
 #ifdef DEBUG
 	printf( "entering utCalendar_cal\n" );
 	printf( "Input value: %lf  Input calendar: %s\n", val, calendar );
 #endif
 
-	if( have_initted == 0 ) {
+	/* The one-value interface builds its own context every time; use 
+	 * utCalendar_cal_batch with a saved context to convert many values.
+	 */
+	if( udu_cal_context_init( &ctx, 1 ) != 0 )
+		return(-1);
+
+	if( (cal_id = utCalendar_cal_id( calendar )) == UDU_CAL_UNKNOWN ) {
+		UDU_STAT_EVENT( UDU_STAT_EV_UNKNOWN_CALENDAR );
+		fprintf( stderr, "WARNING: unknown calendar: \"%s\". Using standard calendar instead!\n", calendar );
+		}
+
+	err = utCalendar_cal_batch( &ctx, &val, 1, dataunits, cal_id, year, month,
+		day, hour, minute, &dsec );
+	*second = (float)dsec;
+
+	return( err );
+}
+
+/******************************************************************************/
+/* Turns a CF-1.0 calendar name into a calendar id.  Do this once, then pass
+ * the id to utCalendar_cal_batch for any number of values.  A NULL calendar
+ * means the standard calendar.  An unknown calendar gives UDU_CAL_UNKNOWN,
+ * which the batch routines treat as standard; warning about it is up to
+ * the caller.
+ */
+udu_calendar_id utCalendar_cal_id( const char *calendar )
+{
+	if( (calendar == NULL) || (strncasecmp(calendar,"standard",8)==0) || (strncasecmp(calendar,"gregorian",9)==0) )
+		return( UDU_CAL_STANDARD );
+
+	else if( (strncasecmp(calendar,"365_day",7)==0) || (strncasecmp(calendar,"noleap",6)==0) )
+		return( UDU_CAL_NOLEAP );
+
+	else if( strncasecmp(calendar,"360_day",7)==0)
+		return( UDU_CAL_360_DAY );
+
+	else if( strncasecmp(calendar,"proleptic_gregorian",19)==0)
+		return( UDU_CAL_PROLEPTIC_GREGORIAN );
+
+	else if( strncasecmp(calendar,"julian",6)==0)
+		return( UDU_CAL_JULIAN );
+
+	else
+		return( UDU_CAL_UNKNOWN );
+}
+
+/******************************************************************************/
+/* The vector version of utCalendar_cal.  Converts the n values in vals, 
+ * given in units dataunits, into dates on the calendar with id 'calendar'
+ * (see utCalendar_cal_id).  The calendar kernel is picked once, and
+ * the results are written straight into the columnar output arrays, each
+ * of which must have room for n values.  Long vectors are split across
+ * ctx->nthreads threads.
+ * Return value is 0 on success, a udunits error code otherwise.
+ */
+int utCalendar_cal_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+		udu_calendar_id calendar, int *year, int *month, int *day, int *hour, int *minute, double *second )
+{
+	udu_batch_kernel kernel;
+	udu_stat_id	stat_id;
+	double		t0 = 0.;
+	int		err;
+
+	if( ! ctx->valid )
+		return( UT_ENOINIT );
+
+	stat_id = UDU_STAT_CAL_STANDARD;
+	switch( calendar ) {
+		case UDU_CAL_NOLEAP:
 #ifdef DEBUG
-		printf( "utCalendar_cal: initting\n" );
+			printf( "utCalendar_cal_batch: using 365-day calendar\n" );
 #endif
-		/*-------------------------------------------------------------------------------------------
-		 * The idea of this snippet is to "trick" the udunits library into telling us the year, month,
-		 * and date that the user specified in the units string.  This prevents us from having to 
-		 * reinvent the wheel by parsing the units string ourselves.  See further comments
-		 * in routine udu_sec_since_ref_date
-		 *------------------------------------------------------------------------------------------*/
-		err = utScan( "seconds since 1234-05-06 00:00", &udu_origin_zero );  /* YYYY-MM-DD used here is irrelevant */
-		if( err == 0 ) {
-			udu_origin_zero.origin = 0.0;   /* override specified YYYY-MM-DD to set to same date as lib uses internally */
-			}
-		else
-			{
-			fprintf( stderr, "Error, could not decode internal date string for reference date!\n" );
-			return(-1);
-			}
-		have_initted = 1;
-		}
+			kernel  = utCalendar_noleap_batch;
+			stat_id = UDU_STAT_CAL_NOLEAP;
+			break;
 
-	if( (calendar == NULL) || (strncasecmp(calendar,"standard",8)==0) || (strncasecmp(calendar,"gregorian",9)==0) ) {
+		case UDU_CAL_360_DAY:
 #ifdef DEBUG
-		printf( "utCalendar_cal: using standard calendar\n" );
+			printf( "utCalendar_cal_batch: using 360-day calendar\n" );
 #endif
-		return( utCalendar( val, dataunits, year, month, day, hour, minute, second ));
-		}
-	else if( (strncasecmp(calendar,"365_day",7)==0) || (strncasecmp(calendar,"noleap",6)==0) ) {
+			kernel  = utCalendar_360_batch;
+			stat_id = UDU_STAT_CAL_360_DAY;
+			break;
+
+		case UDU_CAL_PROLEPTIC_GREGORIAN:
 #ifdef DEBUG
-		printf( "utCalendar_cal: using 365-day calendar\n" );
+			printf( "utCalendar_cal_batch: using proleptic Gregorian calendar\n" );
 #endif
-		return( utCalendar_noleap( val, dataunits, year, month, day, hour, minute, second ));
-		}
-	else if( strncasecmp(calendar,"360_day",7)==0) {
+			kernel  = utCalendar_proleptic_gregorian_batch;
+			stat_id = UDU_STAT_CAL_PROLEPTIC_GREGORIAN;
+			break;
+
+		case UDU_CAL_JULIAN:
+#ifdef DEBUG
+			printf( "utCalendar_cal_batch: using Julian calendar\n" );
+#endif
+			kernel  = utCalendar_julian_batch;
+			stat_id = UDU_STAT_CAL_JULIAN;
+			break;
+
+		default:
 #ifdef DEBUG
-		printf( "utCalendar_cal: using 360-day calendar\n" );
+			printf( "utCalendar_cal_batch: using standard calendar\n" );
 #endif
-		return( utCalendar_360( val, dataunits, year, month, day, hour, minute, second ));
+#ifdef UDU_STD_NATIVE
+			kernel  = utCalendar_standard_batch;
+#else
+			kernel  = utCalendar_std_batch;
+#endif
+			break;
 		}
-	else if( strncasecmp(calendar,"proleptic_gregorian",19)==0) {
-		fprintf( stderr, "sorry, proleptic_gregorian calendar not implemented yet; using standard calendar\n" );
-		return( utCalendar( val, dataunits, year, month, day, hour, minute, second ));
+
+	UDU_STAT_START( t0 );
+	err = kernel( ctx, vals, n, dataunits, year, month, day, hour, minute, second );
+	UDU_STAT_STOP( stat_id, n, t0 );
+
+	return( err );
+}
+
+/******************************************************************************/
+/* As utCalendar_cal_batch, but values that can't be decoded don't stop the
+ * batch: each gets a status in status[i], one of the UDU_VALUE codes, and
+ * those that are not UDU_VALUE_OK get na_int in each integer column and 
+ * na_real for the seconds.  Missing values are NaN (which includes R's NA)
+ * and the nfill fill values (a netCDF _FillValue or missing_value, say);
+ * infinite values, and those too far from the reference date for their year
+ * to fit in an int, are out of range.  An error that affects every value,
+ * such as a unit that is not a time, is still returned as a udunits error
+ * code.  Return value is 0 on success.
+ */
+int utCalendar_cal_batch_status( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+		udu_calendar_id calendar, const double *fill, int nfill, int *year, int *month, int *day, 
+		int *hour, int *minute, double *second, int *status, int na_int, double na_real )
+{
+	size_t	i;
+	int	j, err;
+	long	nbad;
+	double	x;
+
+	nbad = 0;
+	for( i=0; i<n; i++ ) {
+		x = vals[i];
+		status[i] = UDU_VALUE_OK;
+		if( isnan(x) )
+			status[i] = UDU_VALUE_MISSING;
+		else
+			{
+			for( j=0; j<nfill; j++ )
+				if( x == fill[j] )
+					status[i] = UDU_VALUE_MISSING;
+			if( (status[i] == UDU_VALUE_OK) && (! (fabs( x*dataunits->factor ) <= UDU_MAX_SECONDS)) )
+				status[i] = UDU_VALUE_RANGE;
+			}
+		nbad += (status[i] != UDU_VALUE_OK);
 		}
-	else if( strncasecmp(calendar,"julian",6)==0) {
-		fprintf( stderr, "sorry, julian calendar not implemented yet; using standard calendar\n" );
-		return( utCalendar( val, dataunits, year, month, day, hour, minute, second ));
+
+	/* The kernels decode bad values harmlessly, so they are only fixed up afterwards */
+	if( (err = utCalendar_cal_batch( ctx, vals, n, dataunits, calendar, year, month, day, hour, minute, second )) != 0 )
+		return( err );
+
+	for( i=0; (nbad > 0) && (i<n); i++ ) {
+		if( status[i] == UDU_VALUE_OK )
+			continue;
+		year  [i] = na_int;
+		month [i] = na_int;
+		day   [i] = na_int;
+		hour  [i] = na_int;
+		minute[i] = na_int;
+		second[i] = na_real;
+		nbad--;
 		}
-	else
-		{
-		if( ! have_shown_warning ) {
-			fprintf( stderr, "WARNING: unknown calendar: \"%s\". Using standard calendar instead!\n", calendar );
-			have_shown_warning = 1;
-			return( utCalendar( val, dataunits, year, month, day, hour, minute, second ));
-			}
+
+	return(0);
+}
+
+#ifndef UDU_STD_NATIVE
+/******************************************************************************/
+/* The standard (mixed Julian/Gregorian) calendar, done by the udunits library
+ * one value at a time.  This is what utCalendar_cal_batch uses unless the 
+ * package is compiled with -DUDU_STD_NATIVE, which picks the package's own
+ * utCalendar_standard_batch instead; that is not the default until it has
+ * been checked against the library (bench_driver -verify, in inst/bench).
+ * As in the other kernels, values that are not finite or are too far from
+ * the reference date are decoded as the reference date, for
+ * utCalendar_cal_batch_status to mark.
+ */
+static int utCalendar_std_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				int *year, int *month, int *day, int *hour, int *minute, double *second )
+{
+	size_t	i;
+	int	err;
+	float	sec;
+	double	x;
+
+	for( i=0; i<n; i++ ) {
+		x = vals[i];
+		if( ! (fabs( x*dataunits->factor ) <= UDU_MAX_SECONDS) )
+			x = 0.;
+		if( (err = utCalendar( x, dataunits, year+i, month+i, day+i, hour+i, minute+i, &sec )) != 0 )
+			return( err );
+		second[i] = sec;
 		}
+
+	return(0);
 }
+#endif
 
 /******************************************************************************/
-double udu_sec_since_ref_date( double val, utUnit *dataunits, int *yr0, int *mon0, 
-		int *day0, int *hr0, int *min0, float *sec0 )
+/* Builds the context the calendar routines work in.  Call this once, after 
+ * utInit, from a single thread; after that the context is only read, so
+ * any number of threads can use it at once.  nthreads is the number of 
+ * threads to split long vectors across (0 means the OpenMP default).
+ * Returns 0 on success.
+ */
+int udu_cal_context_init( udu_cal_context *ctx, int nthreads )
 {
-	double retval;
 	int err;
 
+#ifdef DEBUG
+	printf( "udu_cal_context_init: initting\n" );
+#endif
+	ctx->valid    = 0;
+	ctx->nthreads = nthreads;
+
+	/*-------------------------------------------------------------------------------------------
+	 * The idea of this snippet is to "trick" the udunits library into telling us the year, month,
+	 * and date that the user specified in the units string.  This prevents us from having to 
+	 * reinvent the wheel by parsing the units string ourselves.  See further comments
+	 * in routine udu_epoch_init
+	 *------------------------------------------------------------------------------------------*/
+	err = utScan( "seconds since 1234-05-06 00:00", &(ctx->origin_zero) );  /* YYYY-MM-DD used here is irrelevant */
+	if( err != 0 ) {
+		fprintf( stderr, "Error, could not decode internal date string for reference date!\n" );
+		return(-1);
+		}
+	ctx->origin_zero.origin = 0.0;   /* override specified YYYY-MM-DD to set to same date as lib uses internally */
+
+	ctx->valid = 1;
+	return(0);
+}
+
+/******************************************************************************/
+/* How many threads to convert n values with
+ */
+static int udu_nthreads( const udu_cal_context *ctx, size_t n )
+{
+#ifdef _OPENMP
+	if( n < UDU_PAR_MIN )
+		return(1);
+	return( (ctx->nthreads > 0) ? ctx->nthreads : omp_get_max_threads() );
+#else
+	return(1);
+#endif
+}
+
+/******************************************************************************/
+/* Decodes the reference date of a time unit ONCE, so that a whole vector of
+ * values in that unit can be converted without going back to the udunits
+ * library for every value.  The reference date is also turned into an
+ * absolute day number in the target calendar, so each value can then be
+ * converted in closed form.
+ * Inputs:
+ *	ctx: the calendar context (see udu_cal_context_init)
+ *	dataunits: the (time) unit the values are given in
+ *	calendar: the calendar the values are to be interpreted in
+ * Outputs:
+ *	ep: the decoded reference epoch
+ * Return value is 0 on success, a udunits error code otherwise.
+ */
+static int udu_epoch_init( const udu_cal_context *ctx, utUnit *dataunits, udu_calendar_id calendar, udu_epoch *ep )
+{
+	long	yr0;
+	int	err;
+	float	sec0;
+	double	t0 = 0.;
+	utUnit	origin_zero;
+
         /*---------------------------------------------------------------------
          * Use a bit of a trick to get the year, month, and day that the
          * original user specified in the units string and was subsequently
@@ -130,141 +392,760 @@ double udu_sec_since_ref_date( double val, utUnit *dataunits, int *yr0, int *mon
          * udunits reference date, into a calendar date.  Voila!  We then
          * have the year, month, day, etc. that the user specified.
          *--------------------------------------------------------------------*/
-	err = utCalendar( dataunits->origin, &udu_origin_zero, yr0,
-		mon0, day0, hr0, min0, sec0 );  /* note: all these yr0 etc values are RETURNED */
+	UDU_STAT_START( t0 );
+	origin_zero = ctx->origin_zero;
+	err = utCalendar( dataunits->origin, &origin_zero, &(ep->yr0),
+		&(ep->mon0), &(ep->day0), &(ep->hr0), &(ep->min0), &sec0 );
+
+	/* origin_zero is always valid, so check the user's unit is a time with an origin */
+	if( (err == 0) && ((! utIsTime( dataunits )) || (! utHasOrigin( dataunits ))) )
+		err = UT_EINVALID;
+
+	/* Failed calls are counted too, with no values */
+	if( err != 0 ) {
+		UDU_STAT_STOP( UDU_STAT_EPOCH_DECODE, 0, t0 );
+		return( err );
+		}
+
+	ep->factor     = dataunits->factor;
+	ep->sec_of_day = (double)(ep->hr0*3600L + ep->min0*60L) + (double)sec0;
+
+	/* The udunits library has no year 0, so year -N (N BC) is astronomical year 1-N */
+	yr0 = ep->yr0;
+	if( ((calendar == UDU_CAL_PROLEPTIC_GREGORIAN) || (calendar == UDU_CAL_JULIAN)) && (yr0 < 0) )
+		yr0++;
+	ep->day_number = udu_daynum_from_date( calendar, yr0, ep->mon0, ep->day0 );
+
+#ifdef DEBUG
+ 	printf( "reference date %04d-%02d-%02d %02d:%02d is day number %lld\n", ep->yr0, ep->mon0, ep->day0, 
+		ep->hr0, ep->min0, (long long)ep->day_number ); 
+#endif
+	UDU_STAT_STOP( UDU_STAT_EPOCH_DECODE, 1, t0 );
+	return(0);
+}
+
+/******************************************************************************/
+/* Floor division for possibly negative day counts
+ */
+static udu_daynum udu_floor_div( udu_daynum a, udu_daynum b )
+{
+	udu_daynum q;
+
+	q = a / b;
+	if( (a % b != 0) && ((a < 0) != (b < 0)) )
+		q--;
+	return( q );
+}
+
+/******************************************************************************/
+/* Splits a value into whole days since the reference day (returned) and
+ * seconds into that day (*ss).  Avoids problems with roundoff and limited
+ * precision: values a hair short of a day boundary count as being on the 
+ * boundary.  Not an exact science.
+ */
+static udu_daynum udu_split_day( double val, const udu_epoch *ep, double *ss )
+{
+	double	sec, nd;
+
+	/* NaN, infinite, or far out of range; decoded as the reference date rather 
+	 * than left undefined, for utCalendar_cal_batch_status to mark
+	 */
+	sec = val * ep->factor;
+	if( ! (fabs( sec ) <= 2.*UDU_MAX_SECONDS) )
+		sec = 0.;
+	sec += ep->sec_of_day;
+	nd  = floor( (sec + .01)/86400. );
+	sec -= nd*86400.;
+	if( sec < 0. )
+		sec = 0.;
+
+	*ss = sec;
+	return( (udu_daynum)nd );
+}
+
+/******************************************************************************/
+/* Splits seconds into the day into hours, minutes, and seconds
+ */
+static void udu_split_time( double ss, int *hour, int *minute, double *second )
+{
+	long	nhrs, nmin;
 
-	retval = val * dataunits->factor;
+	nhrs = (long)(ss / 3600.);
+	ss  -= nhrs * 3600.;
+	nmin = (long)(ss / 60.);
+	ss  -= nmin * 60.;
 
-	return( retval );
+	*hour   = (int)nhrs;
+	*minute = (int)nmin;
+	*second = ss;
 }
 
 /*************************************************************************************/
-/* A calendar with no leap days; days per month and year are passed in, not assumed!  
- * Can pass in days_per_year=365 and days_per_month={30,28,31,30, etc} for a "noleap" calendar,
- * or days_per_year=360 and days_per_month={30,30,30,...} for a "360 day" calendar
+/* A calendar with no leap days; days per year and the cumulative days before each
+ * month are passed in, not assumed!  Can pass in days_per_year=365 and 
+ * days_before_month={0,31,59,90, etc} for a "noleap" calendar, or days_per_year=360 and
+ * days_before_month={0,30,60,...} for a "360 day" calendar.
+ *
+ * Converts n values at once.  The reference date is decoded only once, and each value
+ * is then decoded in closed form (no per-value loops over months or years), so the
+ * values can be split across threads.
  */
-int utCalendar_noleap_inner( double val, utUnit *dataunits, int *year, int *month, int *day, int *hour, 
-				int *minute, float *second, int days_per_year, long *days_per_month )
-{
-	int yr0, mon0, day0, hr0, min0;
-	float sec0;
-	double ss, ss_extra;
-	long dy, ds, sec_per_day, sec_per_hour, sec_per_min, ss_i, nny;
-	long ndays, nhrs, nmin;
-
-	sec_per_day   = 86400;
-	sec_per_hour  = 3600;
-	sec_per_min   = 60;
-
-	/* -------------------------------------------------------------------------------------
-	 * Get both the REFERENCE TIME that the netCDF file specifies for the units string
-	 * (yr0, mon0, day0, etc) and the number of seconds since that reference date.  I.e.,
-	 * if the units string is "days since 1979-01-01", then the reference date is 1 Jan 1979
-	 * and 'ss' is the number of seconds since that date that we want to turn into a calendar
-	 * date, given the specified calendar.
-	 *--------------------------------------------------------------------------------------*/
-	ss = udu_sec_since_ref_date( val, dataunits, &yr0, &mon0, &day0, &hr0, &min0, &sec0 );
-#ifdef DEBUG
- 	printf( "converting time %lf seconds since %04d-%02d-%02d %02d:%02d\n", ss, yr0, mon0, day0, hr0, min0 ); 
-#endif
+static int utCalendar_noleap_inner_batch( const udu_cal_context *ctx, const double *vals, size_t n, 
+				utUnit *dataunits, int *year, int *month, int *day, int *hour, int *minute, 
+				double *second, udu_calendar_id calendar, long days_per_year, 
+				const long *days_before_month )
+{
+	udu_epoch ep;
+	long	i;
+	int	err, nthreads;
+
+	if( (err = udu_epoch_init( ctx, dataunits, calendar, &ep )) != 0 )
+		return( err );
 
-	/*--------------------------------------------------------------------------
-	 * If we have a date before our reference date (indicated by a negative ss),
-	 * then wind back the reference date to to be before the target
-	 * date.  This avoids having to muck around with negative offsets.
-	 *------------------------------------------------------------------------*/
-	if( ss < 0 ) {
-		nny = -ss / (sec_per_day*days_per_year) + 1;
-		yr0 -= nny;
-		ss  += nny * sec_per_day*days_per_year;
+	if( udu_axis_is_regular( vals, n, &ep ))
+		return( utCalendar_step_batch( ctx, vals, n, &ep, calendar, year, month, day, hour, minute, second ));
+
+	nthreads = udu_nthreads( ctx, n );
+
+#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) schedule(static)
+	for( i=0; i<(long)n; i++ ) {
+		udu_daynum absday, dy;
+		long	doy, mm;
+		double	ss;
+
+		absday = ep.day_number + udu_split_day( vals[i], &ep, &ss );
+		dy     = udu_floor_div( absday, days_per_year );
+		doy    = (long)(absday - dy*days_per_year);
+
+		/* No month is longer than 31 days, so doy/31 is either the right month or one short */
+		mm = doy / 31;
+		if( doy >= days_before_month[mm+1] )
+			mm++;
+
+		year [i] = (int)dy;
+		month[i] = (int)(mm + 1);
+		day  [i] = (int)(doy - days_before_month[mm] + 1);
+
+		udu_split_time( ss, hour+i, minute+i, second+i );
 		}
 
-	/*-------------------------------------------------------------------
-	 * We now have seconds since (ss) yr0, mon0, day0, hr0, min0, sec0.
-	 * Try to turn this into integer days since reference date and seconds
-	 * extra, avoiding problems with roundoff and limited precision.  Not
-	 * an exact science.  We use days since (ds) instead of sticking 
-	 * strictly with seconds since (ss) becuase we can overflow longs in
-	 * fairly routine circumstances, if tring to put a century or so of
-	 * seconds into a long.
-	 *-------------------------------------------------------------------*/
-	ds = (long)((ss + .01)/(double)sec_per_day);
-	ss_extra = ss - ((double)ds)*((double)sec_per_day);  /* need to be careful of overflow here */
-	if( ss_extra < 0. )
-		ss_extra = 0;
+	return(0);
+}
 
-#ifdef DEBUG
-	printf( "# of days since ref date: %ld   # of extra seconds after days taken out: %lf\n", ds, ss_extra );
-#endif
+/******************************************************************************/
+int utCalendar_360_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				int *year, int *month, int *day, int *hour, int *minute, double *second )
+{
+	return( utCalendar_noleap_inner_batch( ctx, vals, n, dataunits, year, month, day, hour, minute, second,
+		UDU_CAL_360_DAY, 360L, days_before_month_360 ));
+}
 
-	/*--------------------------------------
-	 * Easier to do things relative to 1 Jan 
-	 *-------------------------------------*/
-	if( (min0 != 0) || (hr0 != 0) || (day0 != 1) || (mon0 != 1)) {
+/******************************************************************************/
+int utCalendar_noleap_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				int *year, int *month, int *day, int *hour, int *minute, double *second )
+{
+	return( utCalendar_noleap_inner_batch( ctx, vals, n, dataunits, year, month, day, hour, minute, second,
+		UDU_CAL_NOLEAP, 365L, days_before_month_reg_year ));
+}
 
-		ss_extra += min0 * sec_per_min;
-		min0 = 0;
+/*************************************************************************************/
+/* Day numbers for the proleptic Gregorian and Julian calendars.  These are Julian Day
+ * Numbers (JDN 2299161 is both Gregorian 1582-10-15 and Julian 1582-10-05), so dates
+ * on the two calendars can be compared directly.  Years are astronomical, i.e., year 0
+ * is 1 BC.  Each conversion is a fixed number of integer operations: years are counted
+ * from 1 March, so the leap day falls at the end of the counted year, and are grouped
+ * into "eras" (400 years for Gregorian, 4 years for Julian) that all have the same
+ * number of days.
+ */
+udu_daynum udu_jdn_from_gregorian( udu_daynum year, int month, int day )
+{
+	udu_daynum era, yoe, doy, doe;
 
-		ss_extra += hr0 * sec_per_hour;
-		hr0 = 0;
+	if( month <= 2 )
+		year--;
+	era = udu_floor_div( year, 400L );
+	yoe = year - era*400L;						/* [0, 399]    */
+	doy = (153L*(month > 2 ? month-3 : month+9) + 2)/5 + (udu_daynum)day - 1;	/* [0, 365]    */
+	doe = yoe*365L + yoe/4 - yoe/100 + doy;				/* [0, 146096] */
 
-		ds += (day0-1);
-		day0 = 1;
+	return( era*146097L + doe + 1721120L );
+}
 
-		while( mon0 > 1 ) {
-			ds += days_per_month[ mon0-2 ];	/*  -2 cuz -1 for prev month, -1 for 0 offset */
-			mon0--;
-			}
+/******************************************************************************/
+void udu_gregorian_from_jdn( udu_daynum jdn, long *year, int *month, int *day )
+{
+	udu_daynum z, era, doe, yoe, doy, mp;
+
+	z   = jdn - 1721120L;
+	era = udu_floor_div( z, 146097L );
+	doe = z - era*146097L;
+	yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+	doy = doe - (365L*yoe + yoe/4 - yoe/100);
+	mp  = (5L*doy + 2)/153;
+
+	*day   = (int)(doy - (153L*mp + 2)/5 + 1);
+	*month = (int)(mp < 10 ? mp+3 : mp-9);
+	*year  = (long)(yoe + era*400L + (*month <= 2 ? 1 : 0));
+}
+
+/******************************************************************************/
+udu_daynum udu_jdn_from_julian( udu_daynum year, int month, int day )
+{
+	udu_daynum era, yoe, doy, doe;
+
+	if( month <= 2 )
+		year--;
+	era = udu_floor_div( year, 4L );
+	yoe = year - era*4L;						/* [0, 3]    */
+	doy = (153L*(month > 2 ? month-3 : month+9) + 2)/5 + (udu_daynum)day - 1;	/* [0, 365]  */
+	doe = yoe*365L + doy;						/* [0, 1460] */
+
+	return( era*1461L + doe + 1721118L );
+}
+
+/******************************************************************************/
+void udu_julian_from_jdn( udu_daynum jdn, long *year, int *month, int *day )
+{
+	udu_daynum z, era, doe, yoe, doy, mp;
+
+	z   = jdn - 1721118L;
+	era = udu_floor_div( z, 1461L );
+	doe = z - era*1461L;
+	yoe = (doe - doe/1460) / 365;
+	doy = doe - 365L*yoe;
+	mp  = (5L*doy + 2)/153;
+
+	*day   = (int)(doy - (153L*mp + 2)/5 + 1);
+	*month = (int)(mp < 10 ? mp+3 : mp-9);
+	*year  = (long)(yoe + era*4L + (*month <= 2 ? 1 : 0));
+}
+
+/*************************************************************************************/
+/* The calendars that count days by Julian Day Number: the standard calendar, the
+ * proleptic Gregorian calendar, and the Julian calendar.  As with the noleap calendars,
+ * the reference date is decoded only once, and then each value is decoded in closed 
+ * form, with integer arithmetic.
+ */
+static int utCalendar_daynum_inner_batch( const udu_cal_context *ctx, const double *vals, size_t n, 
+				utUnit *dataunits, int *year, int *month, int *day, int *hour, int *minute, 
+				double *second, udu_calendar_id calendar )
+{
+	udu_epoch ep;
+	long	i;
+	int	err, nthreads;
+
+	if( (err = udu_epoch_init( ctx, dataunits, calendar, &ep )) != 0 )
+		return( err );
+
+	if( udu_axis_is_regular( vals, n, &ep ))
+		return( utCalendar_step_batch( ctx, vals, n, &ep, calendar, year, month, day, hour, minute, second ));
+
+	nthreads = udu_nthreads( ctx, n );
+
+#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) schedule(static)
+	for( i=0; i<(long)n; i++ ) {
+		double	ss;
+
+		udu_date_from_daynum( calendar, ep.day_number + udu_split_day( vals[i], &ep, &ss ), year+i, month+i, day+i );
+		udu_split_time( ss, hour+i, minute+i, second+i );
+		}
+
+	return(0);
+}
+
+/******************************************************************************/
+/* The standard calendar: Julian up to 1582-10-04, Gregorian from 1582-10-15, with
+ * no year 0, as the udunits library does it (see the check values at the top).
+ */
+int utCalendar_standard_batch( const udu_cal_context *ctx, const double *vals, size_t n, 
+				utUnit *dataunits, int *year, int *month, int *day, int *hour, int *minute, double *second )
+{
+	return( utCalendar_daynum_inner_batch( ctx, vals, n, dataunits, year, month, day, hour, minute, second, 
+			UDU_CAL_STANDARD ));
+}
+
+/******************************************************************************/
+int utCalendar_proleptic_gregorian_batch( const udu_cal_context *ctx, const double *vals, size_t n, 
+				utUnit *dataunits, int *year, int *month, int *day, int *hour, int *minute, double *second )
+{
+	return( utCalendar_daynum_inner_batch( ctx, vals, n, dataunits, year, month, day, hour, minute, second, 
+			UDU_CAL_PROLEPTIC_GREGORIAN ));
+}
+
+/******************************************************************************/
+int utCalendar_julian_batch( const udu_cal_context *ctx, const double *vals, size_t n, 
+				utUnit *dataunits, int *year, int *month, int *day, int *hour, int *minute, double *second )
+{
+	return( utCalendar_daynum_inner_batch( ctx, vals, n, dataunits, year, month, day, hour, minute, second, 
+			UDU_CAL_JULIAN ));
+}
+
+/*************************************************************************************/
+/* Decoding regularly spaced values, such as most netCDF time axes, by stepping.
+ *
+ * Each value's day number and time of day are still worked out from the value
+ * itself, exactly as the direct kernels do, so nothing drifts however long the
+ * axis.  What is saved is turning the day number into a year, month, and day,
+ * which takes several divisions: when a value is less than four weeks after
+ * the one before, its date is found by moving the previous date forward,
+ * which crosses at most one month end.  A value that isn't (a big or backward
+ * step), and the first value of each block, gets a full decode, so one odd
+ * value just costs the time the direct kernel would have taken.  Blocks are
+ * independent, so they can be split across threads.
+ */
+
+/******************************************************************************/
+/* Looks at a sample of the values to see if they are evenly spaced and close
+ * enough together for stepping to be worth it.  A wrong guess only costs time.
+ */
+static int udu_axis_is_regular( const double *vals, size_t n, const udu_epoch *ep )
+{
+	double	step, expect, tol;
+	size_t	i, stride;
+
+	if( n < UDU_STEP_MIN )
+		return(0);
+
+	step = vals[1] - vals[0];
+	if( (! (step > 0.)) || (step * ep->factor >= 27.*86400.) )
+		return(0);
+
+	tol    = 1e-6 * step;
+	stride = n / 64;
+	for( i=2; i<n; i += ((i < 16) ? 1 : stride) ) {
+		expect = vals[0] + (double)i * step;
+		if( ! (fabs( vals[i] - expect ) <= tol) )
+			return(0);
 		}
 
-	dy = ds / days_per_year;
-	*year = yr0 + dy;
-	ds = ds - dy*days_per_year;
+	expect = vals[0] + (double)(n-1) * step;
+	return( fabs( vals[n-1] - expect ) <= tol );
+}
+
+/******************************************************************************/
+/* Date from an absolute day number (see udu_daynum_from_date) */
+static void udu_date_from_daynum( udu_calendar_id calendar, udu_daynum daynum, int *year, int *month, int *day )
+{
+	udu_daynum	dy;
+	long		doy, mm, yy;
+	const long	*dbm;
+
+	switch( calendar ) {
+		case UDU_CAL_NOLEAP:
+		case UDU_CAL_360_DAY:
+			dbm = (calendar == UDU_CAL_NOLEAP) ? days_before_month_reg_year : days_before_month_360;
+			dy  = udu_floor_div( daynum, dbm[12] );
+			doy = (long)(daynum - dy*dbm[12]);
+			mm  = doy / 31;
+			if( doy >= dbm[mm+1] )
+				mm++;
+			*year  = (int)dy;
+			*month = (int)(mm + 1);
+			*day   = (int)(doy - dbm[mm] + 1);
+			break;
+
+		case UDU_CAL_PROLEPTIC_GREGORIAN:
+			udu_gregorian_from_jdn( daynum, &yy, month, day );
+			*year = (int)yy;
+			break;
 
-	*month = 1;
-	while( ds > days_per_month[(*month) - 1] - 1 ) {
-		ds -= days_per_month[(*month) - 1];
-		(*month)++;
+		case UDU_CAL_JULIAN:
+			udu_julian_from_jdn( daynum, &yy, month, day );
+			*year = (int)yy;
+			break;
+
+		default:
+			udu_standard_from_jdn( daynum, &yy, month, day );
+			*year = (int)yy;
+			break;
 		}
+}
 
-	*day = ds + 1;
+/******************************************************************************/
+/* Days in a month.  On the standard calendar October 1582 is taken to have 31, 
+ * as its days are numbered up to 31; the days it skips are left to the caller.
+ */
+static int udu_month_length( udu_calendar_id calendar, int year, int month )
+{
+	static const int mlen[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 
-	nhrs = ss_extra / sec_per_hour;
-	*hour = nhrs;
-	ss_extra -= nhrs * sec_per_hour;
+	if( calendar == UDU_CAL_360_DAY )
+		return( 30 );
+	if( (month != 2) || (calendar == UDU_CAL_NOLEAP) )
+		return( mlen[month-1] );
 
-	nmin = ss_extra / sec_per_min;
-	*minute = nmin;
-	ss_extra -= nmin * sec_per_min;
+	if( calendar == UDU_CAL_STANDARD ) {
+		if( year < 0 )
+			year++;		/* no year 0, so 1 BC is a (Julian) leap year */
+		calendar = (year < 1582) ? UDU_CAL_JULIAN : UDU_CAL_PROLEPTIC_GREGORIAN;
+		}
 
-	*second = ss_extra;
+	if( calendar == UDU_CAL_PROLEPTIC_GREGORIAN )
+		return( ((year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0))) ? 29 : 28 );
+	else
+		return( (year % 4 == 0) ? 29 : 28 );	/* true of negative years too */
+}
+
+/******************************************************************************/
+static int utCalendar_step_batch( const udu_cal_context *ctx, const double *vals, size_t n, const udu_epoch *ep,
+				udu_calendar_id calendar, int *year, int *month, int *day, int *hour, int *minute, 
+				double *second )
+{
+	long	b, nblocks;
+	int	nthreads;
+
+	nblocks  = (long)((n + UDU_STEP_BLOCK - 1) / UDU_STEP_BLOCK);
+	nthreads = udu_nthreads( ctx, n );
+
+#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) schedule(static)
+	for( b=0; b<nblocks; b++ ) {
+		long	i, iend;
+		udu_daynum absday, prev, delta;
+		int	yy, mm, dd, mlen;
+		double	ss;
+
+		i    = b * UDU_STEP_BLOCK;
+		iend = ((size_t)(i + UDU_STEP_BLOCK) < n) ? i + UDU_STEP_BLOCK : (long)n;
+
+		absday = ep->day_number + udu_split_day( vals[i], ep, &ss );
+		udu_date_from_daynum( calendar, absday, &yy, &mm, &dd );
+		mlen = udu_month_length( calendar, yy, mm );
+		prev = absday;
+
+		for( ;; ) {
+			year [i] = yy;
+			month[i] = mm;
+			day  [i] = dd;
+			udu_split_time( ss, hour+i, minute+i, second+i );
+
+			if( ++i >= iend )
+				break;
+
+			absday = ep->day_number + udu_split_day( vals[i], ep, &ss );
+			delta  = absday - prev;
+
+			/* On the standard calendar, a step over the 1582 switch gets a full decode */
+			if( (delta >= 0) && (delta < 28) && 
+			    ((calendar != UDU_CAL_STANDARD) || (prev >= UDU_JDN_GREGORIAN) || (absday < UDU_JDN_GREGORIAN)) ) {
+				dd += (int)delta;
+				if( dd > mlen ) {
+					dd -= mlen;
+					if( ++mm > 12 ) {
+						mm = 1;
+						if( (++yy == 0) && (calendar == UDU_CAL_STANDARD) )
+							yy = 1;
+						}
+					mlen = udu_month_length( calendar, yy, mm );
+					}
+				}
+			else
+				{
+				udu_date_from_daynum( calendar, absday, &yy, &mm, &dd );
+				mlen = udu_month_length( calendar, yy, mm );
+				}
+			prev = absday;
+			}
+		}
 
 	return(0);
 }
 
 /******************************************************************************/
-int utCalendar_360( double val, utUnit *dataunits, int *year, int *month, int *day, int *hour, 
-				int *minute, float *second )
+/* Julian Day Number of a date on the standard (mixed Julian/Gregorian) calendar, 
+ * following the udunits library's conventions: dates from 1582-10-15 on are
+ * Gregorian, earlier ones Julian, and there is no year 0 (year 0 is taken to
+ * be 1 AD, and year -N is N BC).
+ */
+udu_daynum udu_jdn_from_standard( udu_daynum year, int month, int day )
 {
-	long days_per_year;
+	udu_daynum iy;
 
-	days_per_year = 360L;
-	long days_per_month_360[] = { 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30 };
+	if( year == 0 )
+		year = 1;
+	iy = (year < 0) ? year + 1 : year;
 
-	return( utCalendar_noleap_inner( val, dataunits, year, month, day, hour, minute, second,
-		days_per_year, days_per_month_360 ));
+	if( (udu_daynum)day + 31L*(month + 12L*iy) >= 15L + 31L*(10L + 12L*1582L) )
+		return( udu_jdn_from_gregorian( iy, month, day ));
+	else
+		return( udu_jdn_from_julian( iy, month, day ));
 }
 
 /******************************************************************************/
-int utCalendar_noleap( double val, utUnit *dataunits, int *year, int *month, int *day, int *hour, 
-				int *minute, float *second )
+/* Date on the standard calendar of a Julian Day Number (udunits conventions: no year 0) */
+void udu_standard_from_jdn( udu_daynum jdn, long *year, int *month, int *day )
 {
-	long days_per_year;
+	if( jdn >= UDU_JDN_GREGORIAN )
+		udu_gregorian_from_jdn( jdn, year, month, day );
+	else
+		udu_julian_from_jdn( jdn, year, month, day );
 
-	days_per_year = 365L;
+	if( *year <= 0 )
+		(*year)--;
+}
 
-	return( utCalendar_noleap_inner( val, dataunits, year, month, day, hour, minute, second,
-		days_per_year, days_per_month_reg_year ));
+/******************************************************************************/
+/* Absolute day number of a date on any calendar.  For the noleap and 360_day
+ * calendars this is days since the start of year 0 on that calendar; for the
+ * others it is the Julian Day Number.  Months outside 1-12 carry into the year,
+ * and days past the end of a month run on into the following months.
+ */
+static udu_daynum udu_daynum_from_date( udu_calendar_id calendar, udu_daynum year, int month, int day )
+{
+	udu_daynum dy;
+
+	if( (month < 1) || (month > 12) ) {
+		dy     = udu_floor_div( (udu_daynum)month - 1, 12L );
+		year  += dy;
+		month -= (int)(12L*dy);
+		}
+
+	switch( calendar ) {
+		case UDU_CAL_NOLEAP:
+			return( year*365L + days_before_month_reg_year[month-1] + ((udu_daynum)day - 1) );
+
+		case UDU_CAL_360_DAY:
+			return( year*360L + days_before_month_360[month-1] + ((udu_daynum)day - 1) );
+
+		case UDU_CAL_PROLEPTIC_GREGORIAN:
+			return( udu_jdn_from_gregorian( year, month, day ));
+
+		case UDU_CAL_JULIAN:
+			return( udu_jdn_from_julian( year, month, day ));
+
+		default:
+			return( udu_jdn_from_standard( year, month, day ));
+		}
 }
 
+/******************************************************************************/
+/* Nonzero if year/month/day is a date on the calendar: month 1-12, and day
+ * within that month.  On the standard calendar there is no year 0, and
+ * 1582-10-05 through 1582-10-14 were skipped at the switch to Gregorian.
+ */
+int udu_date_is_valid( udu_calendar_id calendar, long year, int month, int day )
+{
+	udu_daynum ndays;
+
+	if( (month < 1) || (month > 12) || (day < 1) )
+		return(0);
+
+	if( (calendar == UDU_CAL_STANDARD) || (calendar == UDU_CAL_UNKNOWN) ) {
+		if( year == 0 )
+			return(0);
+		if( (year == 1582) && (month == 10) && (day > 4) && (day < 15) )
+			return(0);
+		if( (year == 1582) && (month == 10) )
+			return( day <= 31 );	/* the month is 10 days short, but its days run to 31 */
+		}
+
+	ndays = udu_daynum_from_date( calendar, year, month+1, 1 ) - udu_daynum_from_date( calendar, year, month, 1 );
+	return( day <= ndays );
+}
 
+/******************************************************************************/
+/* Day of the year of a date, counting 1 January as day 1 */
+int udu_day_of_year( udu_calendar_id calendar, long year, int month, int day )
+{
+	return( (int)(udu_daynum_from_date( calendar, year, month, day ) - udu_daynum_from_date( calendar, year, 1, 1 )) + 1 );
+}
+
+/******************************************************************************/
+/* Day of the week of a date, 0 = Sunday.  The noleap and 360_day calendars 
+ * have no real weekdays, so for them, as in utDayOfWeek, the date is taken
+ * to be on the Gregorian calendar.
+ */
+int udu_day_of_week( udu_calendar_id calendar, long year, int month, int day )
+{
+	udu_daynum jdn;
+
+	switch( calendar ) {
+		case UDU_CAL_NOLEAP:
+		case UDU_CAL_360_DAY:
+			jdn = udu_jdn_from_gregorian( year, month, day );
+			break;
+
+		default:
+			jdn = udu_daynum_from_date( calendar, year, month, day );
+			break;
+		}
+
+	return( (int)(((jdn + 1) % 7 + 7) % 7) );
+}
+
+/******************************************************************************/
+/* The inverse of utCalendar_cal_batch.  Converts n dates, given as columns
+ * of years, months, days, hours, minutes, and seconds on the calendar with
+ * id 'calendar', into amounts of the time unit dataunits.  The reference date
+ * is decoded once, and each date is converted in closed form, so long 
+ * vectors are split across threads on every calendar.
+ * Return value is 0 on success, a udunits error code otherwise.
+ */
+int utInvCalendar_cal_batch( const udu_cal_context *ctx, const int *year, const int *month, const int *day, 
+		const int *hour, const int *minute, const double *second, size_t n, utUnit *dataunits, 
+		udu_calendar_id calendar, double *value )
+{
+	return( utInvCalendar_cal_batch_status( ctx, year, month, day, hour, minute, second, n, dataunits,
+			calendar, NULL, 0, 0., value ));
+}
+
+/******************************************************************************/
+/* As utInvCalendar_cal_batch, but a date with any field missing (na_int, or
+ * NaN seconds) is skipped: it gets status UDU_VALUE_MISSING and value na_real,
+ * and the others UDU_VALUE_OK.  With status NULL, no field is taken to be
+ * missing.
+ */
+int utInvCalendar_cal_batch_status( const udu_cal_context *ctx, const int *year, const int *month, 
+		const int *day, const int *hour, const int *minute, const double *second, size_t n, 
+		utUnit *dataunits, udu_calendar_id calendar, int *status, int na_int, double na_real, 
+		double *value )
+{
+	udu_epoch ep;
+	long	i;
+	int	err, nthreads;
+	double	t0 = 0.;
+
+	if( ! ctx->valid )
+		return( UT_ENOINIT );
+
+	UDU_STAT_START( t0 );
+	if( (err = udu_epoch_init( ctx, dataunits, calendar, &ep )) != 0 ) {
+		UDU_STAT_STOP( (udu_stat_id)((calendar == UDU_CAL_UNKNOWN) ? UDU_STAT_INV_STANDARD : UDU_STAT_INV_STANDARD + calendar), 0, t0 );
+		return( err );
+		}
+
+	nthreads = udu_nthreads( ctx, n );
+
+#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) schedule(static)
+	for( i=0; i<(long)n; i++ ) {
+		udu_daynum nd;
+
+		if( status != NULL ) {
+			if( (year[i] == na_int) || (month[i] == na_int) || (day[i] == na_int) || 
+			    (hour[i] == na_int) || (minute[i] == na_int) || isnan( second[i] )) {
+				status[i] = UDU_VALUE_MISSING;
+				value [i] = na_real;
+				continue;
+				}
+			status[i] = UDU_VALUE_OK;
+			}
+
+		nd = udu_daynum_from_date( calendar, year[i], month[i], day[i] ) - ep.day_number;
+		value[i] = ((double)nd*86400. + (hour[i]*3600. + minute[i]*60. + second[i] - ep.sec_of_day)) / ep.factor;
+		}
+
+	UDU_STAT_STOP( (udu_stat_id)((calendar == UDU_CAL_UNKNOWN) ? UDU_STAT_INV_STANDARD : UDU_STAT_INV_STANDARD + calendar), n, t0 );
+	return(0);
+}
+
+/******************************************************************************/
+/* Nanoseconds since the Unix epoch of ss seconds into Unix day uday, or 
+ * INT64_MIN (NA) if that is more than 64 bits can hold, about 292 years.
+ */
+static int64_t udu_unix_nanoseconds( udu_daynum uday, double ss )
+{
+	if( (uday < -106751L) || (uday > 106750L) )
+		return( INT64_MIN );
+	return( (int64_t)uday*INT64_C(86400000000000) + (int64_t)llround( ss*1e9 ) );
+}
+
+/******************************************************************************/
+/* Converts n values of a time unit straight to a time since the Unix epoch,
+ * 1970-01-01 00:00:00 UTC, with no dates in between: as seconds (R's POSIXct),
+ * whole days (R's Date), or nanoseconds (64-bit integers, as the bit64
+ * package's integer64 holds them, written into out's memory).
+ *
+ * On the standard, proleptic_gregorian, and julian calendars every value is an
+ * instant in real time, so this is one multiply-add per value.  (R shows such
+ * instants on the proleptic Gregorian calendar, so a standard calendar date
+ * before 1582-10-15 comes out 10 or more days different, but is the same day.)
+ * The noleap and 360_day calendars are not real time, so there the date and time
+ * of day are carried over as they are; a date the Gregorian calendar doesn't
+ * have, such as 30 February, gives NA.  So do values that are not finite.
+ * Return value is 0 on success, a udunits error code otherwise.
+ */
+int utCalendar_cal_unix_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				udu_calendar_id calendar, udu_unix_style style, double *out )
+{
+	udu_epoch	ep;
+	long		i;
+	udu_daynum	day0;
+	int		err, nthreads, real_time;
+	double		t0 = 0.;
+	int64_t		*ns = (int64_t *)out;
+
+	if( ! ctx->valid )
+		return( UT_ENOINIT );
+	if( calendar == UDU_CAL_UNKNOWN )
+		calendar = UDU_CAL_STANDARD;
+
+	UDU_STAT_START( t0 );
+	if( (err = udu_epoch_init( ctx, dataunits, calendar, &ep )) != 0 ) {
+		UDU_STAT_STOP( (udu_stat_id)(UDU_STAT_CAL_STANDARD + calendar), 0, t0 );
+		return( err );
+		}
+
+	real_time = (calendar != UDU_CAL_NOLEAP) && (calendar != UDU_CAL_360_DAY);
+	day0      = ep.day_number - UDU_JDN_UNIX_EPOCH;	/* of the reference date, on a real time calendar */
+	nthreads  = udu_nthreads( ctx, n );
+
+#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) schedule(static)
+	for( i=0; i<(long)n; i++ ) {
+		udu_daynum uday;
+		int	yy, mm, dd;
+		double	ss;
+
+		if( ! isfinite( vals[i] )) {
+			if( style == UDU_UNIX_NANOSECONDS )
+				ns[i] = INT64_MIN;
+			else
+				out[i] = NAN;
+			continue;
+			}
+
+		if( real_time ) {
+			ss = vals[i] * ep.factor + ep.sec_of_day;	/* since the reference date's midnight */
+			switch( style ) {
+				case UDU_UNIX_SECONDS:
+					out[i] = ss + (double)day0*86400.;
+					break;
+				case UDU_UNIX_DAYS:
+					out[i] = floor( ss/86400. ) + (double)day0;
+					break;
+				default:
+					if( ! (fabs( ss ) <= 2.*UDU_MAX_SECONDS) ) {
+						ns[i] = INT64_MIN;
+						break;
+						}
+					uday = (udu_daynum)floor( ss/86400. );
+					ss  -= (double)uday*86400.;
+					ns[i] = udu_unix_nanoseconds( uday + day0, ss );
+					break;
+				}
+			continue;
+			}
+
+		udu_date_from_daynum( calendar, ep.day_number + udu_split_day( vals[i], &ep, &ss ), &yy, &mm, &dd );
+		if( ! udu_date_is_valid( UDU_CAL_PROLEPTIC_GREGORIAN, yy, mm, dd )) {
+			if( style == UDU_UNIX_NANOSECONDS )
+				ns[i] = INT64_MIN;
+			else
+				out[i] = NAN;
+			continue;
+			}
+		uday = udu_jdn_from_gregorian( yy, mm, dd ) - UDU_JDN_UNIX_EPOCH;
+		switch( style ) {
+			case UDU_UNIX_SECONDS:
+				out[i] = (double)uday*86400. + ss;
+				break;
+			case UDU_UNIX_DAYS:
+				out[i] = (double)uday;
+				break;
+			default:
+				ns[i] = udu_unix_nanoseconds( uday, ss );
+				break;
+			}
+		}
+
+	UDU_STAT_STOP( (udu_stat_id)(UDU_STAT_CAL_STANDARD + calendar), n, t0 );
+	return(0);
+}
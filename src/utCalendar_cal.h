@@ -1,3 +1,89 @@
+
+/* Calendars known to utCalendar_cal, as returned by utCalendar_cal_id */
+typedef enum {
+	UDU_CAL_STANDARD = 0,		/* "standard" or "gregorian": mixed Julian/Gregorian, as in udunits */
+	UDU_CAL_NOLEAP,			/* "noleap" or "365_day" */
+	UDU_CAL_360_DAY,		/* "360_day" */
+	UDU_CAL_PROLEPTIC_GREGORIAN,	/* "proleptic_gregorian" */
+	UDU_CAL_JULIAN,			/* "julian" */
+	UDU_CAL_UNKNOWN			/* anything else; treated as standard */
+} udu_calendar_id;
+
+/* What the calendar routines need from the udunits library, set up once by
+ * udu_cal_context_init after utInit and then only read, so that it can be
+ * shared by any number of threads.
+ */
+typedef struct {
+	utUnit	origin_zero;	/* "seconds since" the udunits library's own reference date */
+	int	nthreads;	/* threads to split long vectors across; 0 means the OpenMP default */
+	int	valid;		/* nonzero once initialized */
+} udu_cal_context;
+
+int udu_cal_context_init( udu_cal_context *ctx, int nthreads );
+
 int utCalendar_cal( double val, utUnit *dataunits, int *year, int *month, int *day, int *hour, 
 				int *minute, float *second, char *calendar );
 
+udu_calendar_id utCalendar_cal_id( const char *calendar );
+int utCalendar_cal_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				udu_calendar_id calendar, int *year, int *month, int *day, int *hour, int *minute, 
+				double *second );
+
+/* Status of each value given to utCalendar_cal_batch_status; the same codes as udu_parse_date's */
+#define UDU_VALUE_OK		0
+#define UDU_VALUE_MISSING	1	/* NaN (R's NA) or a fill value */
+#define UDU_VALUE_RANGE		3	/* infinite, or too far from the reference date */
+
+int utCalendar_cal_batch_status( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				udu_calendar_id calendar, const double *fill, int nfill, int *year, int *month, 
+				int *day, int *hour, int *minute, double *second, int *status, int na_int, 
+				double na_real );
+
+/* What utCalendar_cal_unix_batch writes: time since 1970-01-01 00:00:00 UTC in */
+typedef enum {
+	UDU_UNIX_SECONDS = 0,		/* seconds, as R's POSIXct */
+	UDU_UNIX_DAYS,			/* whole days, as R's Date */
+	UDU_UNIX_NANOSECONDS		/* nanoseconds, as 64-bit integers */
+} udu_unix_style;
+
+int utCalendar_cal_unix_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				udu_calendar_id calendar, udu_unix_style style, double *out );
+
+int utInvCalendar_cal_batch( const udu_cal_context *ctx, const int *year, const int *month, const int *day, 
+				const int *hour, const int *minute, const double *second, size_t n, 
+				utUnit *dataunits, udu_calendar_id calendar, double *value );
+int utInvCalendar_cal_batch_status( const udu_cal_context *ctx, const int *year, const int *month, 
+				const int *day, const int *hour, const int *minute, const double *second, 
+				size_t n, utUnit *dataunits, udu_calendar_id calendar, int *status, 
+				int na_int, double na_real, double *value );
+
+int utCalendar_standard_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				int *year, int *month, int *day, int *hour, int *minute, double *second );
+int utCalendar_noleap_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				int *year, int *month, int *day, int *hour, int *minute, double *second );
+int utCalendar_360_batch( const udu_cal_context *ctx, const double *vals, size_t n, utUnit *dataunits, 
+				int *year, int *month, int *day, int *hour, int *minute, double *second );
+int utCalendar_proleptic_gregorian_batch( const udu_cal_context *ctx, const double *vals, size_t n, 
+				utUnit *dataunits, int *year, int *month, int *day, int *hour, int *minute, double *second );
+int utCalendar_julian_batch( const udu_cal_context *ctx, const double *vals, size_t n, 
+				utUnit *dataunits, int *year, int *month, int *day, int *hour, int *minute, double *second );
+
+/* Day numbers, which need more than 32 bits (a long, on Windows) */
+typedef int64_t udu_daynum;
+
+/* Julian Day Numbers <-> dates on the proleptic Gregorian and Julian calendars (astronomical years) */
+udu_daynum udu_jdn_from_gregorian( udu_daynum year, int month, int day );
+void udu_gregorian_from_jdn( udu_daynum jdn, long *year, int *month, int *day );
+udu_daynum udu_jdn_from_julian( udu_daynum year, int month, int day );
+void udu_julian_from_jdn( udu_daynum jdn, long *year, int *month, int *day );
+
+/* Julian Day Number <-> date on the standard calendar (udunits conventions: no year 0) */
+udu_daynum udu_jdn_from_standard( udu_daynum year, int month, int day );
+void udu_standard_from_jdn( udu_daynum jdn, long *year, int *month, int *day );
+
+/* Nonzero if the date exists on the calendar */
+int udu_date_is_valid( udu_calendar_id calendar, long year, int month, int day );
+
+/* Day of the year (1 January is 1), and day of the week (0 = Sunday), of a date */
+int udu_day_of_year( udu_calendar_id calendar, long year, int month, int day );
+int udu_day_of_week( udu_calendar_id calendar, long year, int month, int day );
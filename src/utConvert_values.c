@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include "utConvert_values.h"
+
+/*-----------------------------------------------------------------------------
+ * Kernels that convert whole arrays of values between units, given the
+ * slope and intercept returned by utConvert.  Each is a single pass over
+ * memory.  Values that are NaN (which includes R's NA), or that equal one
+ * of the nfill "fill" values (a netCDF _FillValue or missing_value, say),
+ * are passed through unchanged.  The common case of no fill values is a
+ * separate loop with no branches, so the compiler can vectorize it.
+ * 'in' and 'out' may be the same array.
+ *----------------------------------------------------------------------------*/
+
+/******************************************************************************/
+void utConvert_values_double( const double *in, double *out, size_t n, double slope, double intercept,
+				const double *fill, int nfill )
+{
+	size_t	i;
+	int	j, is_fill;
+	double	x;
+
+	if( nfill == 0 ) {
+		for( i=0; i<n; i++ ) {
+			x = in[i];
+			out[i] = isnan(x) ? x : slope*x + intercept;
+			}
+		return;
+		}
+
+	for( i=0; i<n; i++ ) {
+		x = in[i];
+		is_fill = isnan(x);
+		for( j=0; j<nfill; j++ )
+			is_fill |= (x == fill[j]);
+		out[i] = is_fill ? x : slope*x + intercept;
+		}
+}
+
+/******************************************************************************/
+/* Integer input; na_int is the integer that means "missing" (R's NA_INTEGER),
+ * and comes out as na_out (R's NA_REAL).
+ */
+void utConvert_values_int( const int *in, double *out, size_t n, double slope, double intercept,
+				const double *fill, int nfill, int na_int, double na_out )
+{
+	size_t	i;
+	int	j, is_fill;
+	double	x;
+
+	for( i=0; i<n; i++ ) {
+		if( in[i] == na_int ) {
+			out[i] = na_out;
+			continue;
+			}
+		x = (double)in[i];
+		is_fill = 0;
+		for( j=0; j<nfill; j++ )
+			is_fill |= (x == fill[j]);
+		out[i] = is_fill ? x : slope*x + intercept;
+		}
+}
+
+/*-----------------------------------------------------------------------------
+ * Converter objects.  A utConverter holds the slope and intercept for one
+ * pair of units, so that once utConvert has checked the units are
+ * compatible, the same conversion can be applied to any number of arrays
+ * without looking at the units again.  Two converters can be composed into
+ * one; e.g., K->degC followed by degC->degF gives K->degF, with a single
+ * pass over memory when it is applied.
+ *----------------------------------------------------------------------------*/
+
+/******************************************************************************/
+void utConverter_set( utConverter *conv, double slope, double intercept )
+{
+	conv->slope     = slope;
+	conv->intercept = intercept;
+	conv->identity  = ((slope == 1.0) && (intercept == 0.0));
+}
+
+/******************************************************************************/
+/* result = second(first(x)) = s2*(s1*x + i1) + i2.  result may be the
+ * same as first or second.
+ */
+void utConverter_compose( const utConverter *first, const utConverter *second, utConverter *result )
+{
+	double	slope, intercept;
+
+	slope     = second->slope * first->slope;
+	intercept = second->slope * first->intercept + second->intercept;
+
+	utConverter_set( result, slope, intercept );
+}
+
+/******************************************************************************/
+/* Same as utConvert_values_double, but an identity conversion (e.g., between
+ * "m" and "meters") is just a copy, or nothing at all when in == out.
+ */
+void utConverter_apply_double( const utConverter *conv, const double *in, double *out, size_t n,
+				const double *fill, int nfill )
+{
+	if( conv->identity ) {
+		if( in != out )
+			memcpy( out, in, n*sizeof(double) );
+		return;
+		}
+
+	utConvert_values_double( in, out, n, conv->slope, conv->intercept, fill, nfill );
+}
+
+/******************************************************************************/
+void utConverter_apply_int( const utConverter *conv, const int *in, double *out, size_t n,
+				const double *fill, int nfill, int na_int, double na_out )
+{
+	utConvert_values_int( in, out, n, conv->slope, conv->intercept, fill, nfill, na_int, na_out );
+}
+
+/*-----------------------------------------------------------------------------
+ * Arithmetic on two converted arrays, e.g. adding a temperature in degF to
+ * one in K, with both conversions done on the fly as each value is read,
+ * rather than converting each array into a new one first.  NaN values give
+ * NaN, as in the arithmetic itself.
+ *----------------------------------------------------------------------------*/
+
+#define UDU_APPLY2_LOOP( expr ) \
+	for( i=0, ia=0, ib=0; i<n; i++ ) { \
+		x = sa*a[ia] + ia0; \
+		y = sb*b[ib] + ib0; \
+		out[i] = (expr); \
+		if( ++ia == na ) ia = 0; \
+		if( ++ib == nb ) ib = 0; \
+		}
+
+/******************************************************************************/
+void utConverter_apply2_double( const utConverter *ca, const double *a, size_t na, 
+				const utConverter *cb, const double *b, size_t nb, int op, double *out, size_t n )
+{
+	size_t	i, ia, ib;
+	double	sa = ca->slope, ia0 = ca->intercept, sb = cb->slope, ib0 = cb->intercept, x, y;
+
+	if( (na == 0) || (nb == 0) )
+		return;
+
+	/* Same lengths, the usual case, with no recycling to get in the way of vectorizing */
+	if( (na == n) && (nb == n) ) {
+		switch( op ) {
+			case '+': for( i=0; i<n; i++ ) out[i] = (sa*a[i] + ia0) + (sb*b[i] + ib0); break;
+			case '-': for( i=0; i<n; i++ ) out[i] = (sa*a[i] + ia0) - (sb*b[i] + ib0); break;
+			case '*': for( i=0; i<n; i++ ) out[i] = (sa*a[i] + ia0) * (sb*b[i] + ib0); break;
+			default:  for( i=0; i<n; i++ ) out[i] = (sa*a[i] + ia0) / (sb*b[i] + ib0); break;
+			}
+		return;
+		}
+
+	switch( op ) {
+		case '+': UDU_APPLY2_LOOP( x + y ); break;
+		case '-': UDU_APPLY2_LOOP( x - y ); break;
+		case '*': UDU_APPLY2_LOOP( x * y ); break;
+		default:  UDU_APPLY2_LOOP( x / y ); break;
+		}
+}
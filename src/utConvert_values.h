@@ -0,0 +1,26 @@
+/* Applies out = slope*in + intercept to n values, leaving NaN/NA and fill values unchanged */
+void utConvert_values_double( const double *in, double *out, size_t n, double slope, double intercept,
+				const double *fill, int nfill );
+void utConvert_values_int( const int *in, double *out, size_t n, double slope, double intercept,
+				const double *fill, int nfill, int na_int, double na_out );
+
+/* A conversion between one pair of units, worked out once and then applied many times */
+typedef struct {
+	double	slope;
+	double	intercept;
+	int	identity;	/* nonzero if slope is 1 and intercept is 0 */
+} utConverter;
+
+void utConverter_set( utConverter *conv, double slope, double intercept );
+void utConverter_compose( const utConverter *first, const utConverter *second, utConverter *result );
+void utConverter_apply_double( const utConverter *conv, const double *in, double *out, size_t n,
+				const double *fill, int nfill );
+void utConverter_apply_int( const utConverter *conv, const int *in, double *out, size_t n,
+				const double *fill, int nfill, int na_int, double na_out );
+
+/* out[i] = a'[i] op b'[i] for n values, where a' and b' are the values of a
+ * and b put through converters ca and cb, and a and b (na and nb values) are
+ * recycled as R does; op is one of + - * /.  Each array is read once.
+ */
+void utConverter_apply2_double( const utConverter *ca, const double *a, size_t na, 
+				const utConverter *cb, const double *b, size_t nb, int op, double *out, size_t n );
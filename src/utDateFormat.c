@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include "udunits.h"
+#include "utCalendar_cal.h"
+#include "utDateFormat.h"
+
+/*-----------------------------------------------------------------------------
+ * Formats dates as text, in the layouts print.utDate knows plus ISO-8601.
+ * This is called once per date for long vectors of dates, so the numbers
+ * are written out digit by digit rather than with sprintf.  Fields are
+ * zero padded the same way formatC(x,width=w,flag='0') pads them, so a
+ * negative year comes out as e.g. "-005".
+ *----------------------------------------------------------------------------*/
+
+static const char *udu_month_names[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug",
+					"Sep", "Oct", "Nov", "Dec" };
+static const char *udu_day_names[]   = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+
+/******************************************************************************/
+udu_date_format udu_date_format_id( const char *name )
+{
+	if( strcmp( name, "full" ) == 0 )
+		return( UDU_FMT_FULL );
+	else if( strcmp( name, "slashes" ) == 0 )
+		return( UDU_FMT_SLASHES );
+	else if( strcmp( name, "unix" ) == 0 )
+		return( UDU_FMT_UNIX );
+	else if( strcmp( name, "sci" ) == 0 )
+		return( UDU_FMT_SCI );
+	else if( strcmp( name, "underscore" ) == 0 )
+		return( UDU_FMT_UNDERSCORE );
+	else if( strcmp( name, "iso" ) == 0 )
+		return( UDU_FMT_ISO );
+	else
+		return( UDU_FMT_UNKNOWN );
+}
+
+/******************************************************************************/
+/* Writes v zero padded to at least 'width' characters (counting any minus
+ * sign); returns the number of characters written.
+ */
+static int udu_put_int( char *p, long v, int width )
+{
+	char	tmp[24];
+	int	n, len, neg;
+
+	neg = (v < 0);
+	if( neg ) {
+		v = -v;
+		width--;
+		}
+
+	n = 0;
+	do {
+		tmp[n++] = (char)('0' + v % 10);
+		v /= 10;
+		} while( v > 0 );
+	while( n < width )
+		tmp[n++] = '0';
+
+	len = 0;
+	if( neg )
+		p[len++] = '-';
+	while( n > 0 )
+		p[len++] = tmp[--n];
+
+	return( len );
+}
+
+/******************************************************************************/
+static int udu_put_str( char *p, const char *s )
+{
+	int	len;
+
+	for( len=0; s[len] != '\0'; len++ )
+		p[len] = s[len];
+	return( len );
+}
+
+/******************************************************************************/
+/* Seconds, for the ISO layout.  They are rounded to 'digits' places, but
+ * never up to 60, since carrying into the minutes would need the calendar.
+ * With 9 digits the seconds scaled up don't fit in a 32-bit long (as on
+ * Windows), so they are worked with as 64 bits; what is written fits.
+ */
+static int udu_put_seconds( char *p, double second, int digits )
+{
+	double	scale;
+	int64_t	iscale, frac, maxfrac;
+	long	isec;
+	int	i, len;
+
+	if( digits < 0 )
+		digits = 0;
+	if( digits > 9 )
+		digits = 9;
+
+	for( scale=1., i=0; i<digits; i++ )
+		scale *= 10.;
+
+	iscale  = (int64_t)scale;
+	maxfrac = 60*iscale - 1;
+
+	/* Not finite, or far out of range, comes out as 0 */
+	if( ! (second >= 0.) )
+		frac = 0;
+	else if( second*scale + 0.5 >= (double)maxfrac )
+		frac = maxfrac;
+	else
+		frac = (int64_t)floor( second*scale + 0.5 );
+	isec = (long)(frac / iscale);
+	frac = frac % iscale;
+
+	len = udu_put_int( p, isec, 2 );
+	if( digits > 0 ) {
+		p[len++] = '.';
+		len += udu_put_int( p+len, (long)frac, digits );
+		}
+
+	return( len );
+}
+
+/******************************************************************************/
+int udu_format_date( char *buf, udu_date_format fmt, udu_calendar_id calendar, int year, int month,
+				int day, int hour, int minute, double second, int digits )
+{
+	const char	*mon;
+	char		*p;
+
+	mon = ((month >= 1) && (month <= 12)) ? udu_month_names[month-1] : "???";
+	p   = buf;
+
+	switch( fmt ) {
+		case UDU_FMT_SLASHES:
+			p += udu_put_int( p, year, 4 );   *p++ = '/';
+			p += udu_put_int( p, month, 2 );  *p++ = '/';
+			p += udu_put_int( p, day, 2 );
+			break;
+
+		case UDU_FMT_UNIX:
+			p += udu_put_str( p, udu_day_names[udu_day_of_week( calendar, year, month, day )] );
+			*p++ = ' ';
+			p += udu_put_str( p, mon );       *p++ = ' ';
+			p += udu_put_int( p, day, 1 );    *p++ = ' ';
+			p += udu_put_int( p, hour, 2 );   *p++ = ':';
+			p += udu_put_int( p, minute, 2 ); *p++ = ' ';
+			p += udu_put_int( p, year, 4 );
+			break;
+
+		case UDU_FMT_SCI:
+			p += udu_put_int( p, day, 2 );    *p++ = ' ';
+			p += udu_put_str( p, mon );       *p++ = ' ';
+			p += udu_put_int( p, year, 4 );
+			break;
+
+		case UDU_FMT_UNDERSCORE:
+			p += udu_put_int( p, year, 4 );   *p++ = '_';
+			p += udu_put_str( p, mon );       *p++ = '_';
+			p += udu_put_int( p, day, 2 );
+			break;
+
+		case UDU_FMT_ISO:
+			p += udu_put_int( p, year, 4 );   *p++ = '-';
+			p += udu_put_int( p, month, 2 );  *p++ = '-';
+			p += udu_put_int( p, day, 2 );    *p++ = 'T';
+			p += udu_put_int( p, hour, 2 );   *p++ = ':';
+			p += udu_put_int( p, minute, 2 ); *p++ = ':';
+			p += udu_put_seconds( p, second, digits );
+			break;
+
+		default:	/* full */
+			p += udu_put_int( p, year, 4 );   *p++ = '/';
+			p += udu_put_int( p, month, 2 );  *p++ = '/';
+			p += udu_put_int( p, day, 2 );    *p++ = ' ';
+			p += udu_put_int( p, hour, 2 );   *p++ = ':';
+			p += udu_put_int( p, minute, 2 );
+			break;
+		}
+
+	*p = '\0';
+	return( (int)(p - buf) );
+}
@@ -0,0 +1,22 @@
+/* Layouts known to udu_format_date; the first five are those of print.utDate */
+typedef enum {
+	UDU_FMT_FULL = 0,	/* 1990/06/15 12:43 */
+	UDU_FMT_SLASHES,	/* 1990/06/15 */
+	UDU_FMT_UNIX,		/* Fri Jun 15 12:43 1990 */
+	UDU_FMT_SCI,		/* 15 Jun 1990 */
+	UDU_FMT_UNDERSCORE,	/* 1990_Jun_15 */
+	UDU_FMT_ISO,		/* 1990-06-15T12:43:10 (ISO-8601) */
+	UDU_FMT_UNKNOWN
+} udu_date_format;
+
+/* Longest string udu_format_date can write, including the terminating nul */
+#define UDU_FMT_MAXLEN	64
+
+udu_date_format udu_date_format_id( const char *name );
+
+/* Writes one date into buf, which must have room for UDU_FMT_MAXLEN chars;
+ * returns the length written.  'digits' is the number of decimal places
+ * of the seconds in the ISO layout (0 to 9).
+ */
+int udu_format_date( char *buf, udu_date_format fmt, udu_calendar_id calendar, int year, int month,
+				int day, int hour, int minute, double second, int digits );
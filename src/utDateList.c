@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <udunits.h>
+
+#include <R.h> 
+#include <Rinternals.h>
+#include <Rversion.h>
+#include <R_ext/Rdynload.h>
+
+#include "utDateList.h"
+
+/*-----------------------------------------------------------------------------
+ * A list of "utDate" objects, as returned by utCalendar(style='list'), kept
+ * as the six columns year, month, day, hour, minute, second (exactly what
+ * style='array' returns) rather than as n separate R lists.  Each element is
+ * only made into a "utDate" object when it is asked for.  This needs
+ * ALTREP lists, which came with R 4.3.0; on older versions of R the list is
+ * built in full, but all the utDate objects still share one names vector
+ * and one class vector.
+ *----------------------------------------------------------------------------*/
+#if defined(R_VERSION) && (R_VERSION >= R_Version(4,3,0))
+#define UDU_HAVE_ALTLIST
+#include <R_ext/Altrep.h>
+#endif
+
+static SEXP udu_utDate_names = NULL;
+static SEXP udu_utDate_class = NULL;
+
+/******************************************************************/
+static void udu_init_shared_attribs( void )
+{
+	if( udu_utDate_names != NULL )
+		return;
+
+	udu_utDate_names = allocVector( STRSXP, 6 );
+	R_PreserveObject( udu_utDate_names );
+	SET_STRING_ELT( udu_utDate_names, 0, mkChar("year"  ) );
+	SET_STRING_ELT( udu_utDate_names, 1, mkChar("month" ) );
+	SET_STRING_ELT( udu_utDate_names, 2, mkChar("day"   ) );
+	SET_STRING_ELT( udu_utDate_names, 3, mkChar("hour"  ) );
+	SET_STRING_ELT( udu_utDate_names, 4, mkChar("minute") );
+	SET_STRING_ELT( udu_utDate_names, 5, mkChar("second") );
+
+	udu_utDate_class = allocVector( STRSXP, 1 );
+	R_PreserveObject( udu_utDate_class );
+	SET_STRING_ELT( udu_utDate_class, 0, mkChar("utDate") );
+}
+
+/******************************************************************/
+SEXP R_utDate_make( int year, int month, int day, int hour, int minute, double second )
+{
+	SEXP	sx_date;
+
+	udu_init_shared_attribs();
+
+	PROTECT( sx_date = allocVector( VECSXP, 6 ));
+	SET_VECTOR_ELT( sx_date, 0, ScalarInteger( year   ));
+	SET_VECTOR_ELT( sx_date, 1, ScalarInteger( month  ));
+	SET_VECTOR_ELT( sx_date, 2, ScalarInteger( day    ));
+	SET_VECTOR_ELT( sx_date, 3, ScalarInteger( hour   ));
+	SET_VECTOR_ELT( sx_date, 4, ScalarInteger( minute ));
+	SET_VECTOR_ELT( sx_date, 5, ScalarReal   ( second ));
+
+	setAttrib( sx_date, R_NamesSymbol, udu_utDate_names );
+	setAttrib( sx_date, R_ClassSymbol, udu_utDate_class );
+
+	UNPROTECT(1);
+	return( sx_date );
+}
+
+/******************************************************************/
+/* Makes the i'th utDate from the columns */
+static SEXP udu_columns_elt( SEXP sx_columns, R_xlen_t i )
+{
+	return( R_utDate_make( 
+		INTEGER(VECTOR_ELT(sx_columns,0))[i],
+		INTEGER(VECTOR_ELT(sx_columns,1))[i],
+		INTEGER(VECTOR_ELT(sx_columns,2))[i],
+		INTEGER(VECTOR_ELT(sx_columns,3))[i],
+		INTEGER(VECTOR_ELT(sx_columns,4))[i],
+		REAL   (VECTOR_ELT(sx_columns,5))[i] ));
+}
+
+/******************************************************************/
+/* Builds the whole list of utDate objects from the columns */
+static SEXP udu_columns_expand( SEXP sx_columns )
+{
+	SEXP	 sx_list;
+	R_xlen_t i, n;
+
+	n = XLENGTH( VECTOR_ELT(sx_columns,0) );
+	PROTECT( sx_list = allocVector( VECSXP, n ));
+	for( i=0; i<n; i++ )
+		SET_VECTOR_ELT( sx_list, i, udu_columns_elt( sx_columns, i ));
+
+	UNPROTECT(1);
+	return( sx_list );
+}
+
+#ifdef UDU_HAVE_ALTLIST
+/*-----------------------------------------------------------------------------
+ * data1: the six columns (never modified once made)
+ * data2: R_NilValue, or the fully built list once something needed a data
+ *	pointer or changed an element
+ *----------------------------------------------------------------------------*/
+static R_altrep_class_t udu_utDateList_class;
+
+/******************************************************************/
+static SEXP udu_utDateList_expanded( SEXP x )
+{
+	SEXP sx_list;
+
+	sx_list = R_altrep_data2( x );
+	if( sx_list == R_NilValue ) {
+		PROTECT( sx_list = udu_columns_expand( R_altrep_data1( x )));
+		R_set_altrep_data2( x, sx_list );
+		UNPROTECT(1);
+		}
+
+	return( sx_list );
+}
+
+/******************************************************************/
+static R_xlen_t udu_utDateList_Length( SEXP x )
+{
+	return( XLENGTH( VECTOR_ELT( R_altrep_data1(x), 0 )));
+}
+
+/******************************************************************/
+static SEXP udu_utDateList_Elt( SEXP x, R_xlen_t i )
+{
+	if( R_altrep_data2( x ) != R_NilValue )
+		return( VECTOR_ELT( R_altrep_data2(x), i ));
+
+	return( udu_columns_elt( R_altrep_data1(x), i ));
+}
+
+/******************************************************************/
+static void udu_utDateList_Set_elt( SEXP x, R_xlen_t i, SEXP v )
+{
+	SET_VECTOR_ELT( udu_utDateList_expanded( x ), i, v );
+}
+
+/******************************************************************/
+static void *udu_utDateList_Dataptr( SEXP x, Rboolean writeable )
+{
+	return( DATAPTR( udu_utDateList_expanded( x )));
+}
+
+/******************************************************************/
+static const void *udu_utDateList_Dataptr_or_null( SEXP x )
+{
+	if( R_altrep_data2( x ) == R_NilValue )
+		return( NULL );
+
+	return( DATAPTR_RO( R_altrep_data2(x) ));
+}
+
+/******************************************************************/
+/* Copies share the (read-only) columns until one of them is changed */
+static SEXP udu_utDateList_Duplicate( SEXP x, Rboolean deep )
+{
+	if( R_altrep_data2( x ) != R_NilValue )
+		return( NULL );	/* let R copy the built list */
+
+	return( R_new_altrep( udu_utDateList_class, R_altrep_data1(x), R_NilValue ));
+}
+
+/******************************************************************/
+static SEXP udu_utDateList_Serialized_state( SEXP x )
+{
+	if( R_altrep_data2( x ) != R_NilValue )
+		return( NULL );	/* serialize the built list as a regular list */
+
+	return( R_altrep_data1( x ));
+}
+
+/******************************************************************/
+static SEXP udu_utDateList_Unserialize( SEXP class, SEXP state )
+{
+	return( R_new_altrep( udu_utDateList_class, state, R_NilValue ));
+}
+
+/******************************************************************/
+static Rboolean udu_utDateList_Inspect( SEXP x, int pre, int deep, int pvec, 
+	void (*inspect_subtree)(SEXP, int, int, int) )
+{
+	Rprintf( " utDate list of length %ld (%s)\n", (long)udu_utDateList_Length(x),
+		(R_altrep_data2(x) == R_NilValue) ? "columnar" : "expanded" );
+	return( TRUE );
+}
+#endif
+
+/******************************************************************/
+void R_utDateList_init( DllInfo *dll )
+{
+	udu_init_shared_attribs();
+
+#ifdef UDU_HAVE_ALTLIST
+	udu_utDateList_class = R_make_altlist_class( "utDateList", "udunits", dll );
+
+	R_set_altrep_Length_method           ( udu_utDateList_class, udu_utDateList_Length );
+	R_set_altrep_Inspect_method          ( udu_utDateList_class, udu_utDateList_Inspect );
+	R_set_altrep_Duplicate_method        ( udu_utDateList_class, udu_utDateList_Duplicate );
+	R_set_altrep_Serialized_state_method ( udu_utDateList_class, udu_utDateList_Serialized_state );
+	R_set_altrep_Unserialize_method      ( udu_utDateList_class, udu_utDateList_Unserialize );
+	R_set_altvec_Dataptr_method          ( udu_utDateList_class, udu_utDateList_Dataptr );
+	R_set_altvec_Dataptr_or_null_method  ( udu_utDateList_class, udu_utDateList_Dataptr_or_null );
+	R_set_altlist_Elt_method             ( udu_utDateList_class, udu_utDateList_Elt );
+	R_set_altlist_Set_elt_method         ( udu_utDateList_class, udu_utDateList_Set_elt );
+#endif
+}
+
+/******************************************************************/
+/* If x is a compact utDate list that has not been built out, returns
+ * its columns; otherwise returns R_NilValue.
+ */
+SEXP R_utDateList_columns( SEXP x )
+{
+#ifdef UDU_HAVE_ALTLIST
+	if( ALTREP(x) && R_altrep_inherits( x, udu_utDateList_class ) && (R_altrep_data2(x) == R_NilValue) )
+		return( R_altrep_data1( x ));
+#endif
+	return( R_NilValue );
+}
+
+/******************************************************************/
+SEXP R_utDateList_make( SEXP sx_columns )
+{
+#ifdef UDU_HAVE_ALTLIST
+	return( R_new_altrep( udu_utDateList_class, sx_columns, R_NilValue ));
+#else
+	return( udu_columns_expand( sx_columns ));
+#endif
+}
@@ -0,0 +1,12 @@
+
+/* Builds one "utDate" object, sharing a single names and class vector among all of them */
+SEXP R_utDate_make( int year, int month, int day, int hour, int minute, double second );
+
+/* Turns the columnar (style='array') result of utCalendar into a list of "utDate" objects */
+SEXP R_utDateList_make( SEXP sx_columns );
+
+/* The columns behind a compact utDate list, or R_NilValue if x is not one */
+SEXP R_utDateList_columns( SEXP x );
+
+/* Registers the compact utDate list class; called when the package is loaded */
+void R_utDateList_init( DllInfo *dll );
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "udunits.h"
+#include "utCalendar_cal.h"
+#include "utDateParse.h"
+
+/*-----------------------------------------------------------------------------
+ * Parses date and time strings of the form
+ *
+ *	[+-]Y...Y-M[M]-D[D][(T| +)h[h][:m[m][:s[s][.f...]]]][ *(Z|UTC|(+|-)hh[[:]mm])]
+ *
+ * with white space allowed before and after.  This covers ISO-8601 extended
+ * dates and times and the reference dates used in CF time units.  It is a
+ * single left-to-right pass over each string with no copying and no calls
+ * to the C library's number parsing, which depends on the locale.
+ *----------------------------------------------------------------------------*/
+
+#define UDU_PARSE_MAXDIGITS	9	/* in any integer field, so it can't overflow */
+
+/******************************************************************************/
+/* Reads 1 to maxdig digits at *pp into *v and moves *pp past them; returns
+ * the number read, 0 if there are none, or -1 if there are more than maxdig.
+ */
+static int udu_parse_uint( const char **pp, int maxdig, long *v )
+{
+	const char	*p = *pp;
+	int		n;
+
+	*v = 0;
+	for( n=0; (*p >= '0') && (*p <= '9'); n++, p++ ) {
+		if( n == maxdig )
+			return(-1);
+		*v = 10*(*v) + (*p - '0');
+		}
+
+	*pp = p;
+	return( n );
+}
+
+/******************************************************************************/
+static const char *udu_parse_skip_blanks( const char *p )
+{
+	while( (*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r') )
+		p++;
+	return( p );
+}
+
+/******************************************************************************/
+int udu_parse_date( const char *s, udu_calendar_id calendar, int *year, int *month, int *day,
+				int *hour, int *minute, double *second )
+{
+	const char	*p, *q;
+	long		yr, mon, dy, hr, mn, isec, v, off_hr, off_mn;
+	double		sec, scale;
+	int		neg, off_sign, n;
+
+	p = udu_parse_skip_blanks( s );
+	if( *p == '\0' )
+		return( UDU_PARSE_MISSING );
+
+	/* Date */
+	neg = 0;
+	if( (*p == '-') || (*p == '+') )
+		neg = (*p++ == '-');
+	if( udu_parse_uint( &p, UDU_PARSE_MAXDIGITS, &yr ) <= 0 )
+		return( UDU_PARSE_SYNTAX );
+	if( neg )
+		yr = -yr;
+	if( *p++ != '-' )
+		return( UDU_PARSE_SYNTAX );
+	if( udu_parse_uint( &p, 2, &mon ) <= 0 )
+		return( UDU_PARSE_SYNTAX );
+	if( *p++ != '-' )
+		return( UDU_PARSE_SYNTAX );
+	if( udu_parse_uint( &p, 2, &dy ) <= 0 )
+		return( UDU_PARSE_SYNTAX );
+
+	/* Time, if any */
+	hr  = 0;
+	mn  = 0;
+	sec = 0.;
+	q   = udu_parse_skip_blanks( p );
+	if( (*p == 'T') || ((q != p) && (*q >= '0') && (*q <= '9')) ) {
+		p = (*p == 'T') ? p+1 : q;
+		if( udu_parse_uint( &p, 2, &hr ) <= 0 )
+			return( UDU_PARSE_SYNTAX );
+		if( *p == ':' ) {
+			p++;
+			if( udu_parse_uint( &p, 2, &mn ) <= 0 )
+				return( UDU_PARSE_SYNTAX );
+			if( *p == ':' ) {
+				p++;
+				if( udu_parse_uint( &p, 2, &isec ) <= 0 )
+					return( UDU_PARSE_SYNTAX );
+				sec = (double)isec;
+				if( *p == '.' ) {
+					p++;
+					for( scale=0.1, n=0; (*p >= '0') && (*p <= '9'); p++, n++, scale *= 0.1 )
+						sec += scale*(*p - '0');
+					if( n == 0 )
+						return( UDU_PARSE_SYNTAX );
+					}
+				}
+			}
+		}
+
+	/* Time zone, if any */
+	off_hr = 0;
+	off_mn = 0;
+	p = udu_parse_skip_blanks( p );
+	if( *p == 'Z' )
+		p++;
+	else if( strncmp( p, "UTC", 3 ) == 0 )
+		p += 3;
+	else if( (*p == '+') || (*p == '-') ) {
+		off_sign = (*p++ == '-') ? -1 : 1;
+		if( (n = udu_parse_uint( &p, 4, &v )) <= 0 )
+			return( UDU_PARSE_SYNTAX );
+		if( n > 2 ) {		/* hhmm */
+			off_hr = v / 100;
+			off_mn = v % 100;
+			}
+		else
+			{
+			off_hr = v;
+			if( *p == ':' ) {
+				p++;
+				if( udu_parse_uint( &p, 2, &off_mn ) <= 0 )
+					return( UDU_PARSE_SYNTAX );
+				}
+			}
+		if( (off_hr > 23) || (off_mn > 59) )
+			return( UDU_PARSE_RANGE );
+		off_hr *= off_sign;
+		off_mn *= off_sign;
+		}
+
+	if( *udu_parse_skip_blanks( p ) != '\0' )
+		return( UDU_PARSE_SYNTAX );
+
+	/* Ranges; 24:00:00 is allowed, as the end of the day */
+	if( ! udu_date_is_valid( calendar, yr, (int)mon, (int)dy ))
+		return( UDU_PARSE_RANGE );
+	if( (hr > 24) || (mn > 59) || (sec >= 60.) || ((hr == 24) && ((mn > 0) || (sec > 0.))) )
+		return( UDU_PARSE_RANGE );
+
+	*year   = (int)yr;
+	*month  = (int)mon;
+	*day    = (int)dy;
+	*hour   = (int)(hr - off_hr);
+	*minute = (int)(mn - off_mn);
+	*second = sec;
+
+	return( UDU_PARSE_OK );
+}
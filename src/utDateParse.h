@@ -0,0 +1,14 @@
+/* Status of each string given to udu_parse_date */
+#define UDU_PARSE_OK		0
+#define UDU_PARSE_MISSING	1	/* NA or empty */
+#define UDU_PARSE_SYNTAX	2	/* not a date and time this parser knows */
+#define UDU_PARSE_RANGE		3	/* a field is out of range, or the date is not on the calendar */
+
+/* Parses an ISO-8601 / CF style date and time, e.g. "1990-06-15T12:43:10.5Z",
+ * "1850-1-1 0:0:0", or "2001-01-01 06:00 +05:30", into its fields.  A time
+ * zone offset is taken off, so the fields are in UTC; the minutes can then
+ * be outside 0-59, which utInvCalendar_cal_batch allows.  Returns one of
+ * the UDU_PARSE codes; on failure the fields are left untouched.
+ */
+int udu_parse_date( const char *s, udu_calendar_id calendar, int *year, int *month, int *day,
+				int *hour, int *minute, double *second );
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h>
+#include <udunits.h>
+
+#include <R.h> 
+#include <Rinternals.h>
+#include <Rversion.h>
+#include <R_ext/Rdynload.h>
+
+#include "utConvert_values.h"
+#include "utQuantity.h"
+
+/*-----------------------------------------------------------------------------
+ * The values of a "utQuantity" (see utQuantity in udunits.R), which keeps
+ * the numbers it was made from together with the slope and intercept of
+ * every conversion done to it since.  Asking for its values gives a double
+ * vector that works out each element from the original numbers as it is
+ * read, and only converts the whole vector, in one pass, if something needs
+ * a pointer to all of it.  This needs ALTREP, which came with R 3.5.0 (the
+ * API settled in 3.6.0); on older versions of R the values are converted
+ * straight away, still in one pass.
+ *----------------------------------------------------------------------------*/
+#if defined(R_VERSION) && (R_VERSION >= R_Version(3,6,0))
+#define UDU_HAVE_ALTREAL
+#include <R_ext/Altrep.h>
+#endif
+
+/******************************************************************/
+/* Converts n values of sx_val from element i0 into out */
+static void udu_view_convert( SEXP sx_val, const utConverter *conv, R_xlen_t i0, R_xlen_t n, double *out )
+{
+	if( TYPEOF(sx_val) == INTSXP )
+		utConverter_apply_int( conv, INTEGER(sx_val) + i0, out, n, NULL, 0, NA_INTEGER, NA_REAL );
+	else
+		utConverter_apply_double( conv, REAL(sx_val) + i0, out, n, NULL, 0 );
+}
+
+/******************************************************************/
+static SEXP udu_view_expand( SEXP sx_val, const utConverter *conv )
+{
+	SEXP	sx_out;
+
+	PROTECT( sx_out = allocVector( REALSXP, XLENGTH(sx_val) ));
+	udu_view_convert( sx_val, conv, 0, XLENGTH(sx_val), REAL(sx_out) );
+	UNPROTECT(1);
+
+	return( sx_out );
+}
+
+#ifdef UDU_HAVE_ALTREAL
+/*-----------------------------------------------------------------------------
+ * data1: a list of the original values (never modified) and c(slope, 
+ *	intercept)
+ * data2: R_NilValue, or the converted values once something needed a
+ *	data pointer
+ *----------------------------------------------------------------------------*/
+static R_altrep_class_t udu_view_class;
+
+/******************************************************************/
+static void udu_view_conv( SEXP x, utConverter *conv )
+{
+	const double *coefs = REAL( VECTOR_ELT( R_altrep_data1(x), 1 ));
+
+	utConverter_set( conv, coefs[0], coefs[1] );
+}
+
+/******************************************************************/
+static SEXP udu_view_expanded( SEXP x )
+{
+	utConverter	conv;
+	SEXP		sx_out;
+
+	sx_out = R_altrep_data2( x );
+	if( sx_out == R_NilValue ) {
+		udu_view_conv( x, &conv );
+		PROTECT( sx_out = udu_view_expand( VECTOR_ELT( R_altrep_data1(x), 0 ), &conv ));
+		R_set_altrep_data2( x, sx_out );
+		UNPROTECT(1);
+		}
+
+	return( sx_out );
+}
+
+/******************************************************************/
+static R_xlen_t udu_view_Length( SEXP x )
+{
+	return( XLENGTH( VECTOR_ELT( R_altrep_data1(x), 0 )));
+}
+
+/******************************************************************/
+static double udu_view_Elt( SEXP x, R_xlen_t i )
+{
+	utConverter	conv;
+	double		v;
+
+	if( R_altrep_data2( x ) != R_NilValue )
+		return( REAL( R_altrep_data2(x) )[i] );
+
+	udu_view_conv( x, &conv );
+	udu_view_convert( VECTOR_ELT( R_altrep_data1(x), 0 ), &conv, i, 1, &v );
+	return( v );
+}
+
+/******************************************************************/
+static R_xlen_t udu_view_Get_region( SEXP x, R_xlen_t i, R_xlen_t n, double *buf )
+{
+	utConverter	conv;
+	R_xlen_t	len;
+
+	len = udu_view_Length( x );
+	if( i >= len )
+		return(0);
+	if( n > len - i )
+		n = len - i;
+
+	if( R_altrep_data2( x ) != R_NilValue )
+		memcpy( buf, REAL( R_altrep_data2(x) ) + i, n*sizeof(double) );
+	else
+		{
+		udu_view_conv( x, &conv );
+		udu_view_convert( VECTOR_ELT( R_altrep_data1(x), 0 ), &conv, i, n, buf );
+		}
+
+	return( n );
+}
+
+/******************************************************************/
+static void *udu_view_Dataptr( SEXP x, Rboolean writeable )
+{
+	return( DATAPTR( udu_view_expanded( x )));
+}
+
+/******************************************************************/
+static const void *udu_view_Dataptr_or_null( SEXP x )
+{
+	if( R_altrep_data2( x ) == R_NilValue )
+		return( NULL );
+
+	return( DATAPTR_RO( R_altrep_data2(x) ));
+}
+
+/******************************************************************/
+/* Copies share the (read-only) original values until one of them is changed */
+static SEXP udu_view_Duplicate( SEXP x, Rboolean deep )
+{
+	if( R_altrep_data2( x ) != R_NilValue )
+		return( NULL );	/* let R copy the converted values */
+
+	return( R_new_altrep( udu_view_class, R_altrep_data1(x), R_NilValue ));
+}
+
+/******************************************************************/
+static SEXP udu_view_Serialized_state( SEXP x )
+{
+	if( R_altrep_data2( x ) != R_NilValue )
+		return( NULL );	/* serialize the converted values as a regular vector */
+
+	return( R_altrep_data1( x ));
+}
+
+/******************************************************************/
+static SEXP udu_view_Unserialize( SEXP class, SEXP state )
+{
+	return( R_new_altrep( udu_view_class, state, R_NilValue ));
+}
+
+/******************************************************************/
+static Rboolean udu_view_Inspect( SEXP x, int pre, int deep, int pvec, 
+	void (*inspect_subtree)(SEXP, int, int, int) )
+{
+	const double *coefs = REAL( VECTOR_ELT( R_altrep_data1(x), 1 ));
+
+	Rprintf( " utQuantity values of length %ld, slope %g intercept %g (%s)\n", (long)udu_view_Length(x),
+		coefs[0], coefs[1], (R_altrep_data2(x) == R_NilValue) ? "lazy" : "converted" );
+	return( TRUE );
+}
+#endif
+
+/******************************************************************/
+void R_utQuantity_init( DllInfo *dll )
+{
+#ifdef UDU_HAVE_ALTREAL
+	udu_view_class = R_make_altreal_class( "utQuantityView", "udunits", dll );
+
+	R_set_altrep_Length_method           ( udu_view_class, udu_view_Length );
+	R_set_altrep_Inspect_method          ( udu_view_class, udu_view_Inspect );
+	R_set_altrep_Duplicate_method        ( udu_view_class, udu_view_Duplicate );
+	R_set_altrep_Serialized_state_method ( udu_view_class, udu_view_Serialized_state );
+	R_set_altrep_Unserialize_method      ( udu_view_class, udu_view_Unserialize );
+	R_set_altvec_Dataptr_method          ( udu_view_class, udu_view_Dataptr );
+	R_set_altvec_Dataptr_or_null_method  ( udu_view_class, udu_view_Dataptr_or_null );
+	R_set_altreal_Elt_method             ( udu_view_class, udu_view_Elt );
+	R_set_altreal_Get_region_method      ( udu_view_class, udu_view_Get_region );
+#endif
+}
+
+/******************************************************************/
+SEXP R_utQuantity_view_make( SEXP sx_val, double slope, double intercept )
+{
+	utConverter	conv;
+
+	utConverter_set( &conv, slope, intercept );
+
+	/* Nothing to put off */
+	if( conv.identity && (TYPEOF(sx_val) == REALSXP) )
+		return( sx_val );
+
+#ifdef UDU_HAVE_ALTREAL
+	{
+	SEXP	sx_data, sx_coefs, sx_retval;
+
+	PROTECT( sx_data  = allocVector( VECSXP,  2 ));
+	PROTECT( sx_coefs = allocVector( REALSXP, 2 ));
+	REAL(sx_coefs)[0] = slope;
+	REAL(sx_coefs)[1] = intercept;
+	SET_VECTOR_ELT( sx_data, 0, sx_val   );
+	SET_VECTOR_ELT( sx_data, 1, sx_coefs );
+	sx_retval = R_new_altrep( udu_view_class, sx_data, R_NilValue );
+	UNPROTECT(2);
+	return( sx_retval );
+	}
+#else
+	return( udu_view_expand( sx_val, &conv ));
+#endif
+}
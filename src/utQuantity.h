@@ -0,0 +1,7 @@
+/* A double vector that reads as slope*x + intercept of the values x of
+ * sx_val (double or integer) without converting them until it has to.
+ */
+SEXP R_utQuantity_view_make( SEXP sx_val, double slope, double intercept );
+
+/* Registers the lazy view class; called when the package is loaded */
+void R_utQuantity_init( DllInfo *dll );
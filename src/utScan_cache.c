@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "udunits.h"
+#include "utScan_cache.h"
+#include "utStats.h"
+
+/*-----------------------------------------------------------------------------
+ * A bounded cache of parsed units, keyed by the (normalized) units string.
+ * Programs tend to pass the same few strings ("days since 1850-01-01",
+ * "K", ...) over and over, and parsing them is far more expensive than
+ * looking them up.  The cache is a set-associative hash table: each string
+ * hashes to one set of UDU_CACHE_WAYS slots, and when a set is full the
+ * oldest entry in it is replaced.  Only successful scans are cached.
+ * Strings longer than UDU_CACHE_MAXLEN-1 characters are not cached.
+ *----------------------------------------------------------------------------*/
+#define UDU_CACHE_SETS		256
+#define UDU_CACHE_WAYS		4
+#define UDU_CACHE_MAXLEN	128
+
+typedef struct {
+	unsigned long	hash;
+	char		spec[UDU_CACHE_MAXLEN];		/* empty string: slot unused */
+	utUnit		unit;
+} udu_cache_entry;
+
+static udu_cache_entry	udu_cache[UDU_CACHE_SETS][UDU_CACHE_WAYS];
+static int		udu_cache_next_victim[UDU_CACHE_SETS];
+static long		udu_cache_nentries = 0;
+static double		udu_cache_hits     = 0.;
+static double		udu_cache_misses   = 0.;
+
+/******************************************************************************/
+/* Copies spec into 'out' with leading and trailing white space removed and
+ * internal runs of white space collapsed to a single blank, which udunits
+ * treats the same way.  Returns the normalized length, or -1 if it does
+ * not fit in 'out'.
+ */
+static int udu_cache_normalize( const char *spec, char *out, int maxlen )
+{
+	int	len, pending_blank;
+
+	len           = 0;
+	pending_blank = 0;
+	for( ; *spec != '\0'; spec++ ) {
+		if( isspace( (unsigned char)*spec )) {
+			pending_blank = (len > 0);
+			continue;
+			}
+		if( len + pending_blank >= maxlen - 1 )
+			return(-1);
+		if( pending_blank ) {
+			out[len++] = ' ';
+			pending_blank = 0;
+			}
+		out[len++] = *spec;
+		}
+
+	out[len] = '\0';
+	return( len );
+}
+
+/******************************************************************************/
+/* FNV-1a hash */
+static unsigned long udu_cache_hash( const char *s )
+{
+	unsigned long h = 2166136261UL;
+
+	for( ; *s != '\0'; s++ ) {
+		h ^= (unsigned char)*s;
+		h *= 16777619UL;
+		}
+
+	return( h );
+}
+
+/******************************************************************************/
+/* utScan, counted */
+static int udu_cache_utScan( const char *spec, utUnit *up )
+{
+	double	t0 = 0.;
+	int	err;
+
+	UDU_STAT_START( t0 );
+	err = utScan( spec, up );
+	UDU_STAT_STOP( UDU_STAT_LIB_SCAN, 1, t0 );
+
+	return( err );
+}
+
+/******************************************************************************/
+int utScan_cached( const char *spec, utUnit *up )
+{
+	char		key[UDU_CACHE_MAXLEN];
+	unsigned long	hash;
+	int		i, set, err;
+	udu_cache_entry	*entry;
+
+	if( udu_cache_normalize( spec, key, UDU_CACHE_MAXLEN ) < 0 ) {
+		udu_cache_misses++;
+		return( udu_cache_utScan( spec, up ));
+		}
+
+	hash = udu_cache_hash( key );
+	set  = (int)(hash % UDU_CACHE_SETS);
+
+	for( i=0; i<UDU_CACHE_WAYS; i++ ) {
+		entry = &(udu_cache[set][i]);
+		if( (entry->hash == hash) && (strcmp( entry->spec, key ) == 0) ) {
+			udu_cache_hits++;
+			*up = entry->unit;
+			return(0);
+			}
+		}
+
+	udu_cache_misses++;
+	if( (err = udu_cache_utScan( key, up )) != 0 )
+		return( err );
+
+	/* Take an empty slot in this set if there is one, else the oldest */
+	for( i=0; i<UDU_CACHE_WAYS; i++ )
+		if( udu_cache[set][i].spec[0] == '\0' )
+			break;
+	if( i == UDU_CACHE_WAYS ) {
+		i = udu_cache_next_victim[set];
+		udu_cache_next_victim[set] = (i + 1) % UDU_CACHE_WAYS;
+		}
+	else
+		udu_cache_nentries++;
+
+	entry       = &(udu_cache[set][i]);
+	entry->hash = hash;
+	entry->unit = *up;
+	strcpy( entry->spec, key );
+
+	return(0);
+}
+
+/******************************************************************************/
+void utScan_cache_clear( void )
+{
+	memset( udu_cache, 0, sizeof(udu_cache) );
+	memset( udu_cache_next_victim, 0, sizeof(udu_cache_next_victim) );
+	udu_cache_nentries = 0;
+}
+
+/******************************************************************************/
+void utScan_cache_stats( long *entries, long *capacity, double *hits, double *misses )
+{
+	*entries  = udu_cache_nentries;
+	*capacity = (long)UDU_CACHE_SETS * UDU_CACHE_WAYS;
+	*hits     = udu_cache_hits;
+	*misses   = udu_cache_misses;
+}
+
+/******************************************************************************/
+void utScan_cache_reset_stats( void )
+{
+	udu_cache_hits   = 0.;
+	udu_cache_misses = 0.;
+}
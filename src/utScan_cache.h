@@ -0,0 +1,10 @@
+
+/* Like utScan, but remembers the units strings it has already parsed */
+int utScan_cached( const char *spec, utUnit *up );
+
+/* Forgets every cached unit; must be called whenever the units database is (re)loaded */
+void utScan_cache_clear( void );
+
+/* Current number of entries, capacity, and hit/miss counts */
+void utScan_cache_stats( long *entries, long *capacity, double *hits, double *misses );
+void utScan_cache_reset_stats( void );
@@ -0,0 +1,581 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#define getpid	_getpid
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include "udunits.h"
+#include "utSnapshot.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/*-----------------------------------------------------------------------------
+ * utInit has the udunits library parse the whole units file, which is most
+ * of the start-up time of a short R job.  A snapshot is that work done
+ * ahead of time: every name in the units file, its plural, and each of
+ * those with every SI prefix, resolved by the library itself (utScan) and
+ * written to a binary file.  Since the library resolved each entry, looking
+ * a name up in the snapshot always gives exactly what utScan would.
+ *
+ * File layout (native byte order; the header records which):
+ *	udu_snap_header
+ *	nbuckets unsigned ints: index+1 of the first entry in each hash bucket,
+ *		or 0 if the bucket is empty
+ *	nentries udu_snap_entry structs
+ *	strings_size bytes of NUL-terminated names
+ * The checksum covers everything after the header.  The header also has
+ * the size and modification time of the units file the snapshot was made
+ * from, so a snapshot older than its units file is not used.
+ *----------------------------------------------------------------------------*/
+#define UDU_SNAP_MAGIC		"udusnap"
+#define UDU_SNAP_VERSION	1
+#define UDU_SNAP_BYTEORDER	0x01020304U
+#define UDU_SNAP_PATHLEN	1024
+#define UDU_SNAP_MAXNAME	128
+
+typedef struct {
+	char			magic[8];
+	unsigned int		version;
+	unsigned int		byteorder;
+	unsigned int		maxnum_base;	/* UT_MAXNUM_BASE_QUANTITIES when written */
+	unsigned int		entry_size;	/* sizeof(udu_snap_entry) when written */
+	unsigned int		nentries;
+	unsigned int		nbuckets;	/* a power of 2 */
+	unsigned int		strings_size;
+	unsigned int		unused;
+	double			src_size;	/* the units file's size and modification time */
+	double			src_mtime;
+	unsigned long long	checksum;
+	char			src_path[UDU_SNAP_PATHLEN];
+} udu_snap_header;
+
+typedef struct {
+	double		origin;
+	double		factor;
+	unsigned int	name;		/* offset of the name in the strings */
+	unsigned int	next;		/* index+1 of the next entry in the same bucket; 0 ends the chain */
+	int		hasorigin;
+	short		power[UT_MAXNUM_BASE_QUANTITIES];
+} udu_snap_entry;
+
+/* SI prefixes; a prefix the library doesn't accept just adds no entries */
+static const char *udu_snap_prefixes[] = {
+	"yotta", "zetta", "exa", "peta", "tera", "giga", "mega", "kilo", "hecto", "deka", "deca",
+	"deci", "centi", "milli", "micro", "nano", "pico", "femto", "atto", "zepto", "yocto",
+	"Y", "Z", "E", "P", "T", "G", "M", "k", "h", "da",
+	"d", "c", "m", "u", "n", "p", "f", "a", "z", "y",
+	NULL };
+
+/* The snapshot while it is being built */
+typedef struct {
+	udu_snap_entry	*entries;
+	unsigned int	nentries, maxentries;
+	char		*strings;
+	unsigned int	strings_size, max_strings;
+	unsigned int	*seen;		/* open-addressed set of entries (index+1), to skip duplicates */
+	unsigned int	nseen;		/* a power of 2, kept at least twice nentries */
+} udu_snap_build;
+
+/******************************************************************************/
+/* FNV-1a hash of a name */
+static unsigned int udu_snap_hash( const char *s )
+{
+	unsigned int h = 2166136261U;
+
+	for( ; *s != '\0'; s++ ) {
+		h ^= (unsigned char)*s;
+		h *= 16777619U;
+		}
+
+	return( h );
+}
+
+/******************************************************************************/
+/* Checksum of n bytes, 8 at a time */
+static unsigned long long udu_snap_checksum( const unsigned char *p, size_t n )
+{
+	unsigned long long	h, w;
+	size_t			i;
+
+	h = 14695981039346656037ULL;
+	for( i=0; i+8 <= n; i += 8 ) {
+		memcpy( &w, p+i, 8 );
+		h = (h ^ w) * 1099511628211ULL;
+		}
+	for( ; i<n; i++ )
+		h = (h ^ p[i]) * 1099511628211ULL;
+
+	return( h ^ (h >> 29) );
+}
+
+/******************************************************************************/
+/* Returns the slot in b->seen for 'name': either the one holding it, or 
+ * the empty one where it would go.
+ */
+static unsigned int *udu_snap_seen_slot( udu_snap_build *b, const char *name )
+{
+	unsigned int	k;
+
+	k = udu_snap_hash( name ) & (b->nseen-1);
+	while( (b->seen[k] != 0) && (strcmp( b->strings + b->entries[b->seen[k]-1].name, name ) != 0) )
+		k = (k+1) & (b->nseen-1);
+
+	return( b->seen + k );
+}
+
+/******************************************************************************/
+/* Grows the set of seen names to twice its size.  Returns -1 if out of memory.
+ */
+static int udu_snap_seen_grow( udu_snap_build *b )
+{
+	unsigned int	i;
+
+	free( b->seen );
+	b->nseen = (b->nseen == 0) ? 4096 : 2*b->nseen;
+	if( (b->seen = (unsigned int *)calloc( b->nseen, sizeof(unsigned int) )) == NULL )
+		return(-1);
+
+	for( i=0; i<b->nentries; i++ )
+		*udu_snap_seen_slot( b, b->strings + b->entries[i].name ) = i+1;
+
+	return(0);
+}
+
+/******************************************************************************/
+/* Adds 'name' to the snapshot being built if the library accepts it and it
+ * is not already there.  Returns 0 on success, -1 if out of memory.
+ */
+static int udu_snap_add( udu_snap_build *b, const char *name )
+{
+	utUnit		u;
+	udu_snap_entry	*e;
+	unsigned int	i, len;
+	void		*tmp;
+
+	if( (2*(b->nentries+1) > b->nseen) && (udu_snap_seen_grow( b ) != 0) )
+		return(-1);
+	if( *udu_snap_seen_slot( b, name ) != 0 )
+		return(0);
+
+	if( utScan( (char *)name, &u ) != 0 )
+		return(0);
+
+	if( b->nentries == b->maxentries ) {
+		b->maxentries = (b->maxentries == 0) ? 1024 : 2*b->maxentries;
+		if( (tmp = realloc( b->entries, b->maxentries*sizeof(udu_snap_entry) )) == NULL )
+			return(-1);
+		b->entries = (udu_snap_entry *)tmp;
+		}
+
+	len = (unsigned int)strlen(name) + 1;
+	if( b->strings_size + len > b->max_strings ) {
+		b->max_strings = (b->max_strings == 0) ? 16384 : 2*b->max_strings;
+		if( (tmp = realloc( b->strings, b->max_strings )) == NULL )
+			return(-1);
+		b->strings = (char *)tmp;
+		}
+	memcpy( b->strings + b->strings_size, name, len );
+
+	e = b->entries + b->nentries;
+	memset( e, 0, sizeof(udu_snap_entry) );
+	e->origin    = u.origin;
+	e->factor    = u.factor;
+	e->hasorigin = u.hasorigin;
+	for( i=0; i<UT_MAXNUM_BASE_QUANTITIES; i++ )
+		e->power[i] = u.power[i];
+	e->name = b->strings_size;
+
+	b->strings_size += len;
+	b->nentries++;
+	*udu_snap_seen_slot( b, name ) = b->nentries;
+	return(0);
+}
+
+/******************************************************************************/
+/* Adds a name and all its prefixed forms */
+static int udu_snap_add_prefixed( udu_snap_build *b, const char *name )
+{
+	char	buf[2*UDU_SNAP_MAXNAME];
+	int	i;
+
+	if( udu_snap_add( b, name ) != 0 )
+		return(-1);
+
+	for( i=0; udu_snap_prefixes[i] != NULL; i++ ) {
+		snprintf( buf, sizeof(buf), "%s%s", udu_snap_prefixes[i], name );
+		if( udu_snap_add( b, buf ) != 0 )
+			return(-1);
+		}
+
+	return(0);
+}
+
+/******************************************************************************/
+/* The plural of a unit name, by the usual English rules */
+static void udu_snap_plural( const char *name, char *out, size_t outlen )
+{
+	size_t	len;
+	char	last, prev;
+
+	len  = strlen( name );
+	last = (len > 0) ? name[len-1] : '\0';
+	prev = (len > 1) ? name[len-2] : '\0';
+
+	if( (last == 'y') && (strchr( "aeiou", prev ) == NULL) )
+		snprintf( out, outlen, "%.*sies", (int)(len-1), name );
+	else if( (last == 's') || (last == 'x') || (last == 'z') ||
+		 ((last == 'h') && ((prev == 'c') || (prev == 's'))) )
+		snprintf( out, outlen, "%ses", name );
+	else
+		snprintf( out, outlen, "%ss", name );
+}
+
+/******************************************************************************/
+int udu_snapshot_compile( const char *units_path, const char *snap_path, long *nentries,
+				char *errmsg, size_t errlen )
+{
+	FILE		*f;
+	char		line[1024], name[UDU_SNAP_MAXNAME], flag[8], plural[UDU_SNAP_MAXNAME+4], *hash,
+			tmp_path[UDU_SNAP_PATHLEN+32];
+	udu_snap_build	b;
+	udu_snap_header	hdr;
+	unsigned int	*buckets, i, k;
+	struct stat	st;
+	int		err;
+
+	memset( &b, 0, sizeof(b) );
+	buckets = NULL;
+	err     = -1;
+
+	if( strlen(units_path) >= UDU_SNAP_PATHLEN ) {
+		snprintf( errmsg, errlen, "units file name is too long" );
+		return(-1);
+		}
+
+	if( (stat( units_path, &st ) != 0) || ((f = fopen( units_path, "r" )) == NULL) ) {
+		snprintf( errmsg, errlen, "could not open units file %s", units_path );
+		return(-1);
+		}
+
+	/*---------------------------------------------------------------------
+	 * Each line of the units file is:  name  {P|S}  [definition]  [# comment]
+	 * where P means the name also has a plural form.
+	 *--------------------------------------------------------------------*/
+	while( fgets( line, sizeof(line), f ) != NULL ) {
+		if( (hash = strchr( line, '#' )) != NULL )
+			*hash = '\0';
+		if( sscanf( line, "%127s %7s", name, flag ) != 2 )
+			continue;
+		if( (strcmp( flag, "P" ) != 0) && (strcmp( flag, "S" ) != 0) )
+			continue;
+
+		if( udu_snap_add_prefixed( &b, name ) != 0 )
+			goto nomem;
+		if( strcmp( flag, "P" ) == 0 ) {
+			udu_snap_plural( name, plural, sizeof(plural) );
+			if( udu_snap_add_prefixed( &b, plural ) != 0 )
+				goto nomem;
+			}
+		}
+	fclose( f );
+
+	if( b.nentries == 0 ) {
+		snprintf( errmsg, errlen, "no units found in %s; has utInit() been called?", units_path );
+		goto done;
+		}
+
+	/* Hash table, about half full */
+	memset( &hdr, 0, sizeof(hdr) );
+	hdr.nbuckets = 2;
+	while( hdr.nbuckets < 2*b.nentries )
+		hdr.nbuckets *= 2;
+	if( (buckets = (unsigned int *)calloc( hdr.nbuckets, sizeof(unsigned int) )) == NULL )
+		goto nomem;
+	for( i=0; i<b.nentries; i++ ) {
+		k = udu_snap_hash( b.strings + b.entries[i].name ) & (hdr.nbuckets-1);
+		b.entries[i].next = buckets[k];
+		buckets[k] = i+1;
+		}
+
+	memcpy( hdr.magic, UDU_SNAP_MAGIC, 8 );
+	hdr.version      = UDU_SNAP_VERSION;
+	hdr.byteorder    = UDU_SNAP_BYTEORDER;
+	hdr.maxnum_base  = UT_MAXNUM_BASE_QUANTITIES;
+	hdr.entry_size   = sizeof(udu_snap_entry);
+	hdr.nentries     = b.nentries;
+	hdr.strings_size = b.strings_size;
+	hdr.src_size     = (double)st.st_size;
+	hdr.src_mtime    = (double)st.st_mtime;
+	strcpy( hdr.src_path, units_path );
+
+	/* The checksum runs over the parts in the order they are written */
+	{
+	size_t		nb = hdr.nbuckets*sizeof(unsigned int), ne = b.nentries*sizeof(udu_snap_entry);
+	unsigned char	*all;
+
+	if( (all = (unsigned char *)malloc( nb + ne + b.strings_size )) == NULL )
+		goto nomem;
+	memcpy( all,       buckets,   nb );
+	memcpy( all+nb,    b.entries, ne );
+	memcpy( all+nb+ne, b.strings, b.strings_size );
+	hdr.checksum = udu_snap_checksum( all, nb + ne + b.strings_size );
+
+	/* Write to a temporary file and rename it, so that other processes
+	 * never see a half-written snapshot.  The name has our process id in
+	 * it, so two compiles at once don't write to the same file.
+	 */
+	snprintf( tmp_path, sizeof(tmp_path), "%s.%ld.tmp", snap_path, (long)getpid() );
+	if( ((f = fopen( tmp_path, "wb" )) == NULL) ||
+	    (fwrite( &hdr, sizeof(hdr), 1, f ) != 1) ||
+	    (fwrite( all, nb + ne + b.strings_size, 1, f ) != 1) ||
+	    (fclose( f ) != 0) ) {
+		snprintf( errmsg, errlen, "could not write snapshot file %s", tmp_path );
+		free( all );
+		goto done;
+		}
+	free( all );
+	}
+
+	remove( snap_path );	/* rename() won't replace a file on Windows */
+	if( rename( tmp_path, snap_path ) != 0 ) {
+		snprintf( errmsg, errlen, "could not rename %s to %s", tmp_path, snap_path );
+		goto done;
+		}
+
+	*nentries = (long)b.nentries;
+	err = 0;
+	goto done;
+
+nomem:
+	snprintf( errmsg, errlen, "out of memory" );
+done:
+	free( buckets );
+	free( b.entries );
+	free( b.strings );
+	free( b.seen );
+	return( err );
+}
+
+/******************************************************************************/
+int udu_snapshot_open( const char *snap_path, udu_snapshot *snap, char *errmsg, size_t errlen )
+{
+	const udu_snap_header	*hdr;
+	const udu_snap_entry	*entries;
+	struct stat		st;
+	size_t			off_entries, off_strings;
+	unsigned int		i;
+	int			fd;
+
+	memset( snap, 0, sizeof(udu_snapshot) );
+
+	if( (fd = open( snap_path, O_RDONLY | O_BINARY )) < 0 ) {
+		snprintf( errmsg, errlen, "snapshot %s not found", snap_path );
+		return(-1);
+		}
+	if( (fstat( fd, &st ) != 0) || ((size_t)st.st_size < sizeof(udu_snap_header)) ) {
+		close( fd );
+		snprintf( errmsg, errlen, "snapshot %s is too short", snap_path );
+		return(-1);
+		}
+	snap->size = (size_t)st.st_size;
+
+#ifdef _WIN32
+	if( ((snap->base = malloc( snap->size )) == NULL) ||
+	    (read( fd, snap->base, (unsigned int)snap->size ) != (int)snap->size) ) {
+		close( fd );
+		free( snap->base );
+		memset( snap, 0, sizeof(udu_snapshot) );
+		snprintf( errmsg, errlen, "could not read snapshot %s", snap_path );
+		return(-1);
+		}
+#else
+	if( (snap->base = mmap( NULL, snap->size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED ) {
+		close( fd );
+		memset( snap, 0, sizeof(udu_snapshot) );
+		snprintf( errmsg, errlen, "could not map snapshot %s", snap_path );
+		return(-1);
+		}
+	snap->mapped = 1;
+#endif
+	close( fd );
+
+	/*---------------------------------------------------------------------
+	 * Check the header matches this build, the sizes add up, nothing has
+	 * been changed since the snapshot was written, and the units file it
+	 * was made from has not changed since then either.
+	 *--------------------------------------------------------------------*/
+	hdr         = (const udu_snap_header *)snap->base;
+	off_entries = sizeof(udu_snap_header) + (size_t)hdr->nbuckets*sizeof(unsigned int);
+	off_strings = off_entries + (size_t)hdr->nentries*sizeof(udu_snap_entry);
+
+	if( (memcmp( hdr->magic, UDU_SNAP_MAGIC, 8 ) != 0) || (hdr->version != UDU_SNAP_VERSION) ||
+	    (hdr->byteorder != UDU_SNAP_BYTEORDER) || (hdr->maxnum_base != UT_MAXNUM_BASE_QUANTITIES) ||
+	    (hdr->entry_size != sizeof(udu_snap_entry)) ) {
+		snprintf( errmsg, errlen, "snapshot %s was not made by this version of the package on this kind of machine", snap_path );
+		goto bad;
+		}
+
+	if( (hdr->nbuckets == 0) || ((hdr->nbuckets & (hdr->nbuckets-1)) != 0) || (hdr->strings_size == 0) ||
+	    (off_strings + hdr->strings_size != snap->size) ) {
+		snprintf( errmsg, errlen, "snapshot %s has the wrong size", snap_path );
+		goto bad;
+		}
+
+	if( udu_snap_checksum( (const unsigned char *)snap->base + sizeof(udu_snap_header),
+			snap->size - sizeof(udu_snap_header) ) != hdr->checksum ) {
+		snprintf( errmsg, errlen, "snapshot %s is corrupt (bad checksum)", snap_path );
+		goto bad;
+		}
+
+	snap->header  = hdr;
+	snap->buckets = (const unsigned int *)((const char *)snap->base + sizeof(udu_snap_header));
+	snap->entries = (const char *)snap->base + off_entries;
+	snap->strings = (const char *)snap->base + off_strings;
+
+	/* So that lookups can't run off the end */
+	entries = (const udu_snap_entry *)snap->entries;
+	if( snap->strings[hdr->strings_size-1] != '\0' ) {
+		snprintf( errmsg, errlen, "snapshot %s is corrupt", snap_path );
+		goto bad;
+		}
+	for( i=0; i<hdr->nbuckets; i++ )
+		if( snap->buckets[i] > hdr->nentries ) {
+			snprintf( errmsg, errlen, "snapshot %s is corrupt", snap_path );
+			goto bad;
+			}
+	for( i=0; i<hdr->nentries; i++ )
+		if( (entries[i].name >= hdr->strings_size) || (entries[i].next > hdr->nentries) ) {
+			snprintf( errmsg, errlen, "snapshot %s is corrupt", snap_path );
+			goto bad;
+			}
+
+	if( (hdr->src_path[UDU_SNAP_PATHLEN-1] != '\0') || (stat( hdr->src_path, &st ) != 0) ||
+	    ((double)st.st_size != hdr->src_size) || ((double)st.st_mtime != hdr->src_mtime) ) {
+		snprintf( errmsg, errlen, "snapshot %s is out of date with its units file", snap_path );
+		goto bad;
+		}
+
+	return(0);
+
+bad:
+	udu_snapshot_close( snap );
+	return(-1);
+}
+
+/******************************************************************************/
+void udu_snapshot_close( udu_snapshot *snap )
+{
+	if( snap->base != NULL ) {
+#ifndef _WIN32
+		if( snap->mapped )
+			munmap( snap->base, snap->size );
+		else
+#endif
+			free( snap->base );
+		}
+
+	memset( snap, 0, sizeof(udu_snapshot) );
+}
+
+/******************************************************************************/
+/* Names are looked up as given, apart from leading and trailing white space.
+ * Anything with white space inside (or too long to be a name) is not a
+ * single name, so is never found.
+ */
+int udu_snapshot_lookup( const udu_snapshot *snap, const char *name, utUnit *up )
+{
+	const udu_snap_header	*hdr;
+	const udu_snap_entry	*e;
+	char			key[2*UDU_SNAP_MAXNAME];
+	unsigned int		idx;
+	size_t			len;
+	int			i;
+
+	if( snap->header == NULL )
+		return(-1);
+	hdr = (const udu_snap_header *)snap->header;
+
+	while( isspace( (unsigned char)*name ))
+		name++;
+	len = strlen( name );
+	while( (len > 0) && isspace( (unsigned char)name[len-1] ))
+		len--;
+	if( (len == 0) || (len >= sizeof(key)) )
+		return(-1);
+	memcpy( key, name, len );
+	key[len] = '\0';
+	for( i=0; i<(int)len; i++ )
+		if( isspace( (unsigned char)key[i] ))
+			return(-1);
+
+	idx = snap->buckets[ udu_snap_hash( key ) & (hdr->nbuckets-1) ];
+	while( idx != 0 ) {
+		e = (const udu_snap_entry *)snap->entries + (idx-1);
+		if( strcmp( snap->strings + e->name, key ) == 0 ) {
+			up->origin    = e->origin;
+			up->factor    = e->factor;
+			up->hasorigin = e->hasorigin;
+			for( i=0; i<UT_MAXNUM_BASE_QUANTITIES; i++ )
+				up->power[i] = e->power[i];
+			return(0);
+			}
+		idx = e->next;
+		}
+
+	return(-1);
+}
+
+/******************************************************************************/
+long udu_snapshot_nentries( const udu_snapshot *snap )
+{
+	return( (snap->header == NULL) ? 0L : (long)((const udu_snap_header *)snap->header)->nentries );
+}
+
+/******************************************************************************/
+const char *udu_snapshot_source( const udu_snapshot *snap )
+{
+	return( (snap->header == NULL) ? "" : ((const udu_snap_header *)snap->header)->src_path );
+}
+
+/******************************************************************************/
+int udu_snapshot_lib_path( char *path, size_t len )
+{
+	const char	*p;
+
+	if( ((p = getenv( "UDUNITS_PATH" )) == NULL) || (*p == '\0') ) {
+#ifdef UT_DEFAULT_PATH
+		p = UT_DEFAULT_PATH;
+#else
+		return(-1);
+#endif
+		}
+
+	/* The same full path R's normalizePath gives, as used by utCompileSnapshot */
+#ifdef _WIN32
+	if( _fullpath( path, p, len ) != NULL )
+		return(0);
+#else
+	{
+	char	*full;
+
+	if( (full = realpath( p, NULL )) != NULL ) {
+		snprintf( path, len, "%s", full );
+		free( full );
+		return(0);
+		}
+	}
+#endif
+	snprintf( path, len, "%s", p );
+	return(0);
+}
@@ -0,0 +1,38 @@
+/* A units database snapshot: every unit name known to the udunits library,
+ * already resolved, in a binary file that can be mapped into memory in one go.
+ */
+typedef struct {
+	void		*base;		/* the whole file, mapped or read into memory */
+	size_t		size;
+	int		mapped;		/* nonzero if base came from mmap */
+	const void	*header;
+	const unsigned int *buckets;
+	const void	*entries;
+	const char	*strings;
+} udu_snapshot;
+
+/* Writes a snapshot of the units file 'units_path' to 'snap_path'.  utInit must
+ * have been called.  Returns 0 on success; otherwise -1, with a message in errmsg.
+ */
+int udu_snapshot_compile( const char *units_path, const char *snap_path, long *nentries,
+				char *errmsg, size_t errlen );
+
+/* Maps snapshot 'snap_path' into memory and checks it is intact and up to date with
+ * the units file it was made from.  Returns 0 on success; otherwise -1, with the
+ * reason in errmsg, and snap is left empty.
+ */
+int udu_snapshot_open( const char *snap_path, udu_snapshot *snap, char *errmsg, size_t errlen );
+void udu_snapshot_close( udu_snapshot *snap );
+
+/* Looks up a unit name; returns 0 and sets *up if found, -1 if not */
+int udu_snapshot_lookup( const udu_snapshot *snap, const char *name, utUnit *up );
+
+/* The units file utInit(NULL) has the library load: the one UDUNITS_PATH names, or
+ * else the library's default if its header says what that is, as a full path where
+ * one can be found.  Returns 0 on success, or -1 if there is no telling.
+ */
+int udu_snapshot_lib_path( char *path, size_t len );
+
+/* Number of names in an open snapshot, and the units file it was made from */
+long udu_snapshot_nentries( const udu_snapshot *snap );
+const char *udu_snapshot_source( const udu_snapshot *snap );
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+#include "utStats.h"
+
+/*-----------------------------------------------------------------------------
+ * Hot-path statistics; see utStats.h.  The counters are doubles, so they
+ * don't overflow however long R runs.  The calendar routines can be called
+ * from several threads at once, so with OpenMP the counters are updated
+ * atomically; the kernels themselves are timed from outside their parallel
+ * loops, never per value.
+ *----------------------------------------------------------------------------*/
+int udu_stats_level = UDU_STATS_OFF;
+
+typedef struct {
+	double	calls, values, nanosec;
+} udu_stat;
+
+static udu_stat udu_stats[UDU_STAT_COUNT];
+
+/* In udu_stat_id order */
+static const char *udu_stat_names[UDU_STAT_COUNT] = {
+	"utScan",
+	"utScanMany",
+	"utCalendar",
+	"utCalendar.build",
+	"utInvCalendar",
+	"utConvert",
+	"utConvertValues",
+	"utFormatDate",
+	"utParseDate",
+	"utCalendarBins",
+	"utCalendarRemap",
+	"utCalendarStream",
+	"utTimeIndex",
+	"utQuantity.arith",
+	"kernel.standard",
+	"kernel.noleap",
+	"kernel.360_day",
+	"kernel.proleptic_gregorian",
+	"kernel.julian",
+	"inverse.standard",
+	"inverse.noleap",
+	"inverse.360_day",
+	"inverse.proleptic_gregorian",
+	"inverse.julian",
+	"epoch.decode",
+	"library.utScan",
+	"fallback.unknown_calendar",
+	"snapshot.hit",
+	"snapshot.miss",
+	"library.load",
+	"convert.native"
+};
+
+/******************************************************************************/
+/* Monotonic clock, in nanoseconds */
+static double udu_stats_now( void )
+{
+#if defined(_WIN32)
+	static LARGE_INTEGER	freq;
+	LARGE_INTEGER		count;
+
+	if( freq.QuadPart == 0 )
+		QueryPerformanceFrequency( &freq );
+	QueryPerformanceCounter( &count );
+	return( 1e9 * (double)count.QuadPart / (double)freq.QuadPart );
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec	ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return( 1e9*(double)ts.tv_sec + (double)ts.tv_nsec );
+#else
+	struct timeval	tv;
+
+	gettimeofday( &tv, NULL );
+	return( 1e9*(double)tv.tv_sec + 1e3*(double)tv.tv_usec );
+#endif
+}
+
+/******************************************************************************/
+void udu_stats_set_level( int level )
+{
+	if( level < UDU_STATS_OFF )
+		level = UDU_STATS_OFF;
+	if( level > UDU_STATS_TIMING )
+		level = UDU_STATS_TIMING;
+	udu_stats_level = level;
+}
+
+/******************************************************************************/
+const char *udu_stats_name( udu_stat_id id )
+{
+	return( udu_stat_names[id] );
+}
+
+/******************************************************************************/
+int udu_stats_is_event( udu_stat_id id )
+{
+	return( id >= UDU_STAT_EV_UNKNOWN_CALENDAR );
+}
+
+/******************************************************************************/
+void udu_stats_get( udu_stat_id id, double *calls, double *values, double *nanosec )
+{
+	*calls   = udu_stats[id].calls;
+	*values  = udu_stats[id].values;
+	*nanosec = udu_stats[id].nanosec;
+}
+
+/******************************************************************************/
+void udu_stats_reset( void )
+{
+	memset( udu_stats, 0, sizeof(udu_stats) );
+}
+
+/******************************************************************************/
+/* Start of a timed section: the time now if timing, else 0 */
+double udu_stats_start( void )
+{
+	return( (udu_stats_level >= UDU_STATS_TIMING) ? udu_stats_now() : 0. );
+}
+
+/******************************************************************************/
+/* End of a timed section that processed nvalues values, begun at time t0
+ * (from udu_stats_start); events pass t0 = 0.
+ */
+void udu_stats_add( udu_stat_id id, double nvalues, double t0 )
+{
+	double	ns;
+
+	ns = ((t0 > 0.) && (udu_stats_level >= UDU_STATS_TIMING)) ? udu_stats_now() - t0 : 0.;
+
+#pragma omp atomic
+	udu_stats[id].calls += 1.;
+#pragma omp atomic
+	udu_stats[id].values += nvalues;
+#pragma omp atomic
+	udu_stats[id].nanosec += ns;
+}
@@ -0,0 +1,72 @@
+/* Counters (and optionally timers) for the package's hot paths.  Each
+ * statistic counts calls, values processed, and nanoseconds spent; events
+ * such as fallbacks only count calls.  Collecting is off until turned on
+ * with udu_stats_set_level, and when off each instrumented call costs one
+ * test of an int.  Compiling with -DUDU_NO_STATS takes it out altogether.
+ */
+typedef enum {
+	/* R entry points */
+	UDU_STAT_R_SCAN = 0,
+	UDU_STAT_R_SCAN_MANY,
+	UDU_STAT_R_CALENDAR,
+	UDU_STAT_R_CALENDAR_BUILD,	/* making the R objects utCalendar returns */
+	UDU_STAT_R_INV_CALENDAR,
+	UDU_STAT_R_CONVERT,
+	UDU_STAT_R_CONVERT_VALUES,	/* utConvertValues and utConverterApply */
+	UDU_STAT_R_FORMAT_DATE,
+	UDU_STAT_R_PARSE_DATE,
+	UDU_STAT_R_CALENDAR_BINS,
+	UDU_STAT_R_CALENDAR_REMAP,
+	UDU_STAT_R_CALENDAR_STREAM,
+	UDU_STAT_R_TIME_INDEX,
+	UDU_STAT_R_QUANTITY,		/* fused utQuantity arithmetic */
+
+	/* Calendar kernels, one per calendar, in udu_calendar_id order */
+	UDU_STAT_CAL_STANDARD,
+	UDU_STAT_CAL_NOLEAP,
+	UDU_STAT_CAL_360_DAY,
+	UDU_STAT_CAL_PROLEPTIC_GREGORIAN,
+	UDU_STAT_CAL_JULIAN,
+	UDU_STAT_INV_STANDARD,
+	UDU_STAT_INV_NOLEAP,
+	UDU_STAT_INV_360_DAY,
+	UDU_STAT_INV_PROLEPTIC_GREGORIAN,
+	UDU_STAT_INV_JULIAN,
+	UDU_STAT_EPOCH_DECODE,		/* decoding a time unit's reference date */
+	UDU_STAT_LIB_SCAN,		/* utScan calls that reach the udunits library */
+
+	/* Events */
+	UDU_STAT_EV_UNKNOWN_CALENDAR,	/* unknown calendar, treated as standard */
+	UDU_STAT_EV_SNAPSHOT_HIT,
+	UDU_STAT_EV_SNAPSHOT_MISS,
+	UDU_STAT_EV_LIB_LOAD,		/* units file read, after being put off by a snapshot */
+	UDU_STAT_EV_NATIVE_CONVERT,	/* conversion done without the udunits library */
+
+	UDU_STAT_COUNT
+} udu_stat_id;
+
+#define UDU_STATS_OFF		0
+#define UDU_STATS_COUNTS	1
+#define UDU_STATS_TIMING	2	/* counts, and time spent */
+
+extern int udu_stats_level;
+
+void		udu_stats_set_level( int level );
+const char	*udu_stats_name( udu_stat_id id );
+int		udu_stats_is_event( udu_stat_id id );
+void		udu_stats_get( udu_stat_id id, double *calls, double *values, double *nanosec );
+void		udu_stats_reset( void );
+
+/* Use these rather than the functions below */
+double	udu_stats_start( void );
+void	udu_stats_add( udu_stat_id id, double nvalues, double t0 );
+
+#ifdef UDU_NO_STATS
+#define UDU_STAT_START(t0)		((void)0)
+#define UDU_STAT_STOP(id,nvalues,t0)	((void)0)
+#define UDU_STAT_EVENT(id)		((void)0)
+#else
+#define UDU_STAT_START(t0)		do { if( udu_stats_level ) (t0) = udu_stats_start(); } while(0)
+#define UDU_STAT_STOP(id,nvalues,t0)	do { if( udu_stats_level ) udu_stats_add( (id), (double)(nvalues), (t0) ); } while(0)
+#define UDU_STAT_EVENT(id)		do { if( udu_stats_level ) udu_stats_add( (id), 0., 0. ); } while(0)
+#endif
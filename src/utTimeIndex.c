@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "udunits.h"
+#include "utTimeIndex.h"
+
+/*-----------------------------------------------------------------------------
+ * Locates date ranges on a sorted time axis, e.g. to subset JJA of 1981-2010
+ * out of a long run.  The caller encodes just the ends of the ranges on the
+ * axis's unit and calendar, and here each end is found on the axis by binary
+ * search; or, if the axis looks evenly spaced, by working out where it should
+ * be and checking its neighbours.  Either way nothing is decoded, and the
+ * cost depends on the number of ranges rather than the length of the axis.
+ *----------------------------------------------------------------------------*/
+
+/* How far from its guessed place a value is looked for before falling back to a search */
+#define UDU_INDEX_WALK	4
+
+typedef struct {
+	size_t	start, end;	/* end is one past the last index */
+} udu_index_run;
+
+/******************************************************************************/
+/* Whether the axis looks evenly spaced, judging by a few values; if so, sets
+ * *step.  It only has to be a good guess, since guesses are checked.
+ */
+static int udu_index_is_regular( const double *axis, size_t n, double *step )
+{
+	size_t	k, j;
+
+	if( n < 3 )
+		return(0);
+
+	*step = (axis[n-1] - axis[0]) / (double)(n-1);
+	if( ! (*step > 0.) || ! isfinite( *step ))
+		return(0);
+
+	for( j=1; j<4; j++ ) {
+		k = (n-1)*j/4;
+		if( fabs( axis[k] - (axis[0] + (double)k * *step) ) > 1e-6 * *step )
+			return(0);
+		}
+
+	return(1);
+}
+
+/******************************************************************************/
+/* The first index i with axis[i] >= v, or n if there is none */
+static size_t udu_index_lower_bound( const double *axis, size_t n, double v, int regular, double step )
+{
+	size_t	lo, hi, mid, i;
+	double	g;
+	int	k;
+
+	lo = 0;
+	hi = n;
+
+	if( regular ) {
+		g = ceil( (v - axis[0]) / step );
+		i = (g <= 0.) ? 0 : ((g >= (double)n) ? n : (size_t)g);
+
+		for( k=0; k<UDU_INDEX_WALK; k++ ) {
+			if( (i > 0) && (axis[i-1] >= v) )
+				i--;
+			else if( (i < n) && (axis[i] < v) )
+				i++;
+			else
+				return( i );
+			}
+		}
+
+	while( lo < hi ) {
+		mid = lo + (hi - lo)/2;
+		if( axis[mid] < v )
+			lo = mid + 1;
+		else
+			hi = mid;
+		}
+
+	return( lo );
+}
+
+/******************************************************************************/
+static int udu_index_run_cmp( const void *a, const void *b )
+{
+	const udu_index_run	*ra = (const udu_index_run *)a, *rb = (const udu_index_run *)b;
+
+	return( (ra->start > rb->start) - (ra->start < rb->start) );
+}
+
+/******************************************************************************/
+int udu_time_index( const double *axis, size_t n, const double *lo, const double *hi, size_t nranges,
+			double *start, double *end, size_t *nruns )
+{
+	udu_index_run	*run;
+	size_t		r, nrun, k;
+	double		step = 0.;
+	int		regular;
+
+	*nruns = 0;
+	if( (n == 0) || (nranges == 0) )
+		return(0);
+	if( (run = (udu_index_run *)malloc( nranges*sizeof(udu_index_run) )) == NULL )
+		return( UT_EALLOC );
+
+	regular = udu_index_is_regular( axis, n, &step );
+
+	for( nrun=0, r=0; r<nranges; r++ ) {
+		if( isnan( lo[r] ) || isnan( hi[r] ) || (lo[r] >= hi[r]) )
+			continue;
+		run[nrun].start = udu_index_lower_bound( axis, n, lo[r], regular, step );
+		run[nrun].end   = udu_index_lower_bound( axis, n, hi[r], regular, step );
+		if( run[nrun].end > run[nrun].start )
+			nrun++;
+		}
+
+	/* Ranges are usually given in order already, but needn't be */
+	qsort( run, nrun, sizeof(udu_index_run), udu_index_run_cmp );
+
+	for( k=0, r=0; r<nrun; r++ ) {
+		if( (k > 0) && (run[r].start <= (size_t)end[k-1] + 1) ) {
+			if( run[r].end - 1 > (size_t)end[k-1] )
+				end[k-1] = (double)(run[r].end - 1);
+			continue;
+			}
+		start[k] = (double)run[r].start;
+		end  [k] = (double)(run[r].end - 1);
+		k++;
+		}
+
+	free( run );
+	*nruns = k;
+	return(0);
+}
@@ -0,0 +1,10 @@
+/* Finds where the nranges ranges lo[r] <= t < hi[r] fall on the n values of
+ * axis, which must be increasing.  Writes the runs of axis indices (from 0)
+ * that they select to start[] and end[] (inclusive), in order and with runs
+ * that overlap or touch merged, and sets *nruns to how many there are; at
+ * most nranges.  Ranges with a bound that is not a number select nothing.
+ * The work depends on the number of ranges, not the length of the axis.
+ * Returns 0 on success, a udunits error code otherwise.
+ */
+int udu_time_index( const double *axis, size_t n, const double *lo, const double *hi, size_t nranges,
+			double *start, double *end, size_t *nruns );